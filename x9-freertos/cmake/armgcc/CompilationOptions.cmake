@@ -11,6 +11,13 @@ add_compile_options(
     -mfpu=vfpv3-d16
 )
 
+# Assets go to AssetDataPreload and are copied to SDRAM with DMA at startup.
+# Images with QUL_RESOURCE_CACHE_POLICY "NoCaching" go to AssetDataKeepInFlash
+# and are read from QSPI instead, e.g. large rarely shown images:
+#   set_source_files_properties(big.png PROPERTIES QUL_RESOURCE_CACHE_POLICY "NoCaching")
+# Icons and flat graphics shrink with QUL_RESOURCE_COMPRESSION ON; 32-bit RLE
+# images are decoded into the platform texture cache on first draw:
+#   set_source_files_properties(icon.png PROPERTIES QUL_RESOURCE_COMPRESSION ON)
 add_compile_definitions(
     QUL_STATIC_NO_PRELOAD_ASSET_SEGMENT=AssetDataKeepInFlash
     QUL_STATIC_ASSET_SEGMENT=AssetDataPreload
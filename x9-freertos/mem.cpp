@@ -18,61 +18,94 @@
 ** $QT_END_LICENSE$
 **
 ******************************************************************************/
-#ifdef __cplusplus
-extern "C" {
-    #include "heap.h"
-}
-#endif
+#include "sdrvallocator.h"
+#include "sdrvtexturecache.h"
 
-#include "string.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
 
 #include <platform/mem.h>
+#include <cstdio>
 
 namespace Qul {
 namespace Platform {
 
+// Tasks beyond this are left out of the stack report
+#define MAX_REPORTED_TASKS 32
+
 // ![printMemoryStats]
 void printHeapStats(void)
 {
-    //malloc_stats(); // gcc function prining stats to standard error
+    Allocator::printStats();
+    printf("heap: sdk free %u, minimum ever free %u\n",
+           (unsigned)xPortGetFreeHeapSize(),
+           (unsigned)xPortGetMinimumEverFreeHeapSize());
+    TextureCache::printStats();
 }
 
 void printStackStats(void)
 {
-    // Replace this with actual measuring for your platform
-    //uint32_t maxUsedStackSize = 0;
-    //fprintf(stderr, "max used stack size: %u\r\n", maxUsedStackSize);
+    static TaskStatus_t tasks[MAX_REPORTED_TASKS];
+    const UBaseType_t count = uxTaskGetSystemState(tasks, MAX_REPORTED_TASKS, NULL);
+    if (count == 0) {
+        printf("stack: more than %d tasks, not reported\n", MAX_REPORTED_TASKS);
+        return;
+    }
+
+    printf("stack: %-20s %12s\n", "task", "unused bytes");
+    for (UBaseType_t i = 0; i < count; ++i) {
+        printf("stack: %-20s %12u\n",
+               tasks[i].pcTaskName,
+               (unsigned)(tasks[i].usStackHighWaterMark * sizeof(StackType_t)));
+    }
 }
 // ![printMemoryStats]
 
+static void memoryStatsReport(TimerHandle_t)
+{
+    printHeapStats();
+    printStackStats();
+}
+
+void startMemoryStatsReport(uint32_t periodMs)
+{
+    TimerHandle_t timer = xTimerCreate("qul_memstats", pdMS_TO_TICKS(periodMs), pdTRUE, NULL, memoryStatsReport);
+    if (!timer || xTimerStart(timer, 0) != pdPASS)
+        printf("memory stats timer start failed\n");
+}
+
+// Small Qul objects (items, bindings, property nodes) are touched every
+// frame, with a hot pool they live in internal SRAM while it lasts
+static Allocator::MemoryType cpuMemoryType(std::size_t size)
+{
+    return SDRV_HOT_POOL_SIZE && size <= SDRV_SLAB_MAX_SIZE ? Allocator::Memory_CpuHot : Allocator::Memory_CpuDefault;
+}
+
 // ![memAlloc]
+// Small objects come from size-class slabs, only large blocks (framebuffers,
+// textures) go to the SDK heap with DC/G2D friendly alignment
 void *qul_malloc(std::size_t size)
 {
-        return malloc(0x1000, size);
+    return Allocator::allocate(size, cpuMemoryType(size), __builtin_return_address(0));
 }
 
 void qul_free(void *ptr)
 {
-    efree(ptr);
+    Allocator::release(ptr);
 }
 
 void *qul_realloc(void *ptr, size_t s)
 {
-    if (!ptr)
-    {
-        return qul_malloc(s);
-    }
-
     if (s == 0)
     {
         qul_free(ptr);
         return qul_malloc(0);
     }
+    if (!ptr)
+        return Allocator::allocate(s, cpuMemoryType(s), __builtin_return_address(0));
 
-    void* new_ptr = qul_malloc(s);
-    memcpy(new_ptr, ptr, s);
-    qul_free(ptr);
-    return new_ptr;
+    return Allocator::reallocate(ptr, s, __builtin_return_address(0));
 }
 // ![memAlloc]
 
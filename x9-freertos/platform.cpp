@@ -30,10 +30,9 @@
 #include <platform/alloc.h>
 #include <platform/singlepointtoucheventdispatcher.h>
 
-#include <qul/eventqueue.h> // for input handling
-#include <qul/singleton.h>  // for input handling (temperature)
 
 //#include <ctime> //
+#include <algorithm>
  #include <cstring> // for memcpy
 #include <cstdint>
 
@@ -44,19 +43,53 @@
 #include "disp_data_type.h"
 #include <g2dlite_api.h>
 
+#include "sdrvallocator.h"
+#include "sdrvassetpreload.h"
+#include "sdrvboot.h"
+#include "sdrvclock.h"
+#include "sdrvdma.h"
+#include "sdrvframepacer.h"
+#include "sdrvg2dblit.h"
+#include "sdrvg2dlock.h"
+#include "sdrvinput.h"
+#include "sdrvopaquemap.h"
+#include "sdrvprofiler.h"
+#include "sdrvrle.h"
+#include "sdrvscreenbuffer.h"
+#include "sdrvscreens.h"
+#include "sdrvtexturecache.h"
+#include "sdrvtilemask.h"
+#include "sdrvwakeup.h"
+
 #define USE_HW_ACC 1
+// Gives up waiting when the display interrupts stay silent this long
+#define VSYNC_TIMEOUT_MS 100
+
+
 
+// QUL_COLOR_DEPTH of the build, selects RGB565 or ARGB8888 framebuffers
+#ifndef SDRV_COLOR_DEPTH
+#define SDRV_COLOR_DEPTH 32
+#endif
 
-#define RES_G2D_G2D2 0x4362200A
+#if SDRV_COLOR_DEPTH == 16
+#define FRAMEBUFFER_BYTES_PER_PIXEL 2
+#define FRAMEBUFFER_HW_FORMAT COLOR_RGB565
+#define FRAMEBUFFER_PIXEL_FORMAT Qul::PixelFormat_RGB16
+#else
+#define FRAMEBUFFER_BYTES_PER_PIXEL 4
+#define FRAMEBUFFER_HW_FORMAT COLOR_ARGB8888
+#define FRAMEBUFFER_PIXEL_FORMAT Qul::PixelFormat_ARGB32
+#endif
 
 #define DISPLAY_QT_TEMPLATE { \
     1,/*layer*/\
     0,/*layer_dirty*/\
     1,/*layer_en*/\
-    COLOR_ARGB8888,/*fmt*/\
+    FRAMEBUFFER_HW_FORMAT,/*fmt*/\
     {0,0,1920,720},/*x,y,w,h src */ \
     {0x0,0x0,0x0,0x0},/*y,u,v,a*/ \
-    {7680,0,0,0},/*stride*/ \
+    {1920 * FRAMEBUFFER_BYTES_PER_PIXEL,0,0,0},/*stride*/ \
     {0,0,1920,720},/*start*/ \
     {0,0,1920,720},/*dst*/ \
     0,/*ckey_en*/\
@@ -83,8 +116,9 @@ extern void *qul_malloc(std::size_t size);
 //! [waitForBufferFlip]
 static volatile bool waitingForBufferFlip = false;
 static uint32_t idleTimeWaitingForDisplay = 0;
-
-static int QT_DISPLAY_ID = SCREEN_1;
+// Set while the engine task blocks on a display interrupt, so that idle
+// vsyncs do not wake it up
+static volatile bool waitingForVsync = false;
 
 struct g2dlite {
     int index;
@@ -102,10 +136,17 @@ static void waitForBufferFlip()
     // Has there already been a buffer flip?
     if (!waitingForBufferFlip)
         return;
+    SDRV_PROFILE_SCOPE(Phase_VsyncWait);
     const uint64_t startTime = currentTimestamp();
+    waitingForVsync = true;
     while (waitingForBufferFlip) {
         //waitForInterrupt(BUFFER_FLIP_INTERRUPT, 1);
+        if (!waitForEngineWakeup(Wakeup_Vsync, VSYNC_TIMEOUT_MS)) {
+            printf("waitForBufferFlip: no buffer flip interrupt\n");
+            break;
+        }
     }
+    waitingForVsync = false;
 
     idleTimeWaitingForDisplay = currentTimestamp() - startTime;
 }
@@ -118,6 +159,8 @@ static void waitForBufferFlip()
 void LCD_BufferFlipInterruptHandler()
 {
     waitingForBufferFlip = false;
+    if (waitingForVsync)
+        signalEngineWakeupFromISR(Wakeup_Vsync);
 }
 //! [waitForBufferFlip]
 
@@ -133,55 +176,123 @@ static volatile int refreshCount = 1;
 void LCD_RefreshInterruptHandler()
 {
     ++refreshCount;
+    // Also the refresh timing the frame pacer reads
+    Screens::vsyncFromISR(0);
+    if (waitingForVsync)
+        signalEngineWakeupFromISR(Wakeup_Vsync);
 }
 //! [refreshInterrupt]
 
+// Same for the vsync of the second display (sdm display SCREEN_2), without
+// it the frames of the second screen are posted unpaced
+void LCD2_RefreshInterruptHandler()
+{
+    Screens::vsyncFromISR(1);
+}
+
+// Note: To be called by the board's touch controller driver for every
+// sample, from its interrupt handler or from the task reading the controller
+// out. screen is the index into Screens::all(), timestampUs when the sample
+// was taken (clockUs()), 0 for now. Moves are coalesced per frame and, with
+// QUL_X9_TOUCH_PREDICTION, predicted to the touched screen's next vsync.
+void Touch_InterruptHandler(int screen, int x, int y, bool pressed, uint64_t timestampUs)
+{
+    Input::postTouch(screen, x, y, pressed, timestampUs);
+}
+
+// Note: To be called from the G2D completion interrupt once blits are
+// submitted asynchronously, so that the engine task waiting for them can
+// continue.
+void G2D_CompletionInterruptHandler()
+{
+    signalEngineWakeupFromISR(Wakeup_G2D);
+}
+
 //! [framebuffer]
-// Assuming we use 32bpp framebuffers
-static const int BytesPerPixel = 4;
-static unsigned char* framebuffer[2];//[BytesPerPixel * ScreenWidth * ScreenHeight];
+static const int BytesPerPixel = FRAMEBUFFER_BYTES_PER_PIXEL;
+static unsigned char* framebuffer[2];//[BytesPerPixel * ScreenWidth * ScreenHeight], see acquireScreenBuffer
 static int backBufferIndex = 0;
+// beginFrame had no buffer to draw into, presentFrame posts nothing
+static bool frameSkipped = false;
 //! [framebuffer]
+// The framebuffer path only drives the first screen, see sdrvscreens.
+// Further screens have no framebuffers and must be drawn with layers.
 static const int ScreenWidth = QUL_DEFAULT_SCREEN_WIDTH;
 static const int ScreenHeight = QUL_DEFAULT_SCREEN_HEIGHT;
 
-static unsigned char * temp;
-static unsigned char * bgtemp;
+static bool isFramebufferScreen(const PlatformInterface::Screen *screen)
+{
+    return Screens::indexOf(screen) <= 0;
+}
+
+#if SDRV_TILED_FRAMEBUFFER
+// Tiles the CPU fallbacks wrote into the back buffer, and the tiles the last
+// presented frame changed, which the other buffer still lacks
+static SDRVTileMask cpuTiles;
+static SDRVTileMask presentedTiles;
+#endif
 
 //! [initializeDisplay]
-void initializeDisplay(const PlatformInterface::Screen *)
+void initializeDisplay(const PlatformInterface::Screen *screen)
 {
     //initLcd(screen->size().width(), screen->size().height());
+    if (!isFramebufferScreen(screen)) {
+        // Further screens get their sdm display from the layer engine
+        printf("initializeDisplay: screen %d is only driven by the layer engine, it needs layers\n",
+               Screens::indexOf(screen));
+        return;
+    }
+    const int displayId = Screens::displayId(screen);
     struct list_node *head = sdm_get_display_list();
     list_for_every_entry(head, m_sdm, sdm_display_t, node) {
-        if (m_sdm->handle->display_id == QT_DISPLAY_ID)
+        if (m_sdm->handle->display_id == displayId)
             break;
     }
     printf("QT display_id %d\n", m_sdm->handle->display_id);
-
-    framebuffer[0] = (unsigned char*) qul_malloc(BytesPerPixel * ScreenWidth * ScreenHeight);
-    framebuffer[1] = (unsigned char*) qul_malloc(BytesPerPixel * ScreenWidth * ScreenHeight);
-    temp = (unsigned char*) qul_malloc(BytesPerPixel * 288 * 288);
-    bgtemp = (unsigned char*) qul_malloc(BytesPerPixel * 1920 * 720);
-    memset(bgtemp, 0xff, 1920 * 720*4);
+    bootMark("display found");
+    // Framebuffers are allocated by the first beginFrame, they are not
+    // needed at all when the layer engine drives the display
+#if SDRV_TILED_FRAMEBUFFER
+    cpuTiles.reset(ScreenWidth, ScreenHeight);
+    presentedTiles.reset(ScreenWidth, ScreenHeight);
+#endif
 }
 //! [initializeDisplay]
 
+#if SDRV_MEM_STATS_PERIOD_MS
+static void startMemoryStatsReportDeferred(void *)
+{
+    startMemoryStatsReport(SDRV_MEM_STATS_PERIOD_MS);
+}
+#endif
+
+#if !defined(__ICCARM__)
+// Asset preload segment, from x9-platform.ld
+extern "C" unsigned char _preloadable_assetdata_src;
+extern "C" unsigned char _preloadable_assetdata_dst_begin;
+extern "C" unsigned char _preloadable_assetdata_dst_end;
+#endif
+
 //! [initializeHardware]
 void initializeHardware()
 {
     //printf("kyle initializeHardware begin\n");
+    bootMark("initializeHardware");
+#if SDRV_MEM_STATS_PERIOD_MS
+    deferUntilFirstFrame(startMemoryStatsReportDeferred, NULL);
+#endif
     //init g2dlite()
-    int ret;
-    ret = hal_g2dlite_creat_handle(&G2D, RES_G2D_G2D2);
-    if (!ret) {
-        printf("g2dlite creat handle failed\n");
-    }
-
-    hal_g2dlite_init(G2D);
-    printf("g2d->index 0x%x\n", ((struct g2dlite *)G2D)->index);
-
+    G2D = g2dHandle();
+    initG2DLock();
+    if (G2D)
+        printf("g2d->index 0x%x\n", ((struct g2dlite *)G2D)->index);
+    bootMark("g2d initialized");
+
+#if SDRV_COLOR_DEPTH == 16
+    Qul::PlatformInterface::init16bppRendering();
+#else
     Qul::PlatformInterface::init32bppRendering();
+#endif
 #if 0
     Replace the following code with actual code for your device.
 
@@ -204,20 +315,16 @@ void initializeHardware()
     char *_preloadable_assetdata_dst_begin = (char *) (__section_begin("AssetDataPreload"));
     char *_preloadable_assetdata_dst_end = (char *) (__section_end("AssetDataPreload"));
 
-    memcpy(_preloadable_assetdata_dst_begin,
-           _preloadable_assetdata_src,
-           (unsigned) _preloadable_assetdata_dst_end - (unsigned) _preloadable_assetdata_dst_begin);
+    startAssetPreload(_preloadable_assetdata_dst_begin,
+                      _preloadable_assetdata_src,
+                      (unsigned) _preloadable_assetdata_dst_end - (unsigned) _preloadable_assetdata_dst_begin);
     //! [preloadingAssetsIAR]
 #else
     //! [preloadingAssets]
     // Preloading assets
-    // extern unsigned char _preloadable_assetdata_src;
-    // extern unsigned char _preloadable_assetdata_dst_begin;
-    // extern unsigned char _preloadable_assetdata_dst_end;
-
-    // memcpy(&_preloadable_assetdata_dst_begin,
-    //        &_preloadable_assetdata_src,
-    //        &_preloadable_assetdata_dst_end - &_preloadable_assetdata_dst_begin);
+    startAssetPreload(&_preloadable_assetdata_dst_begin,
+                      &_preloadable_assetdata_src,
+                      &_preloadable_assetdata_dst_end - &_preloadable_assetdata_dst_begin);
 //! [preloadingAssets]
 #endif
     //printf("kyle initializeHardware end\n");
@@ -301,9 +408,8 @@ double rand()
 //! [currentTimestamp]
 uint64_t currentTimestamp()
 {
-    uint32_t time = current_time();
-    //printf("kyle currentTimestamp %d, %llu\n", time, (uint64_t)time);
-    return time;
+    // current_time() is a 32-bit millisecond count that wraps after ~49 days
+    return clockMs();
 }
 //! [currentTimestamp]
 
@@ -314,6 +420,7 @@ void scheduleEngineUpdate(uint64_t time)
 {
     //printf("kyle scheduleEngineUpdate %llu\n", time);
     nextUpdate = time;
+    signalEngineWakeup(Wakeup_EngineUpdate);
 }
 //! [nextUpdate]
 
@@ -321,27 +428,47 @@ void scheduleEngineUpdate(uint64_t time)
 static uint64_t last_time = 0llu;
 static  int frame = 0;
 static int lastframe = 0;
-static bool already_copy_source = false;
 static bool already_copy_bg = false;
 void exec()
 {
     //printf("kyle exec start\n");
+    bootMark("exec");
+    initEngineWakeup();
+    // The DMA copy ran alongside the rest of the startup, the first frame
+    // reads the assets
+    waitForAssetPreload();
     last_time = currentTimestamp();
     while (true) {
         //printf("kyle exec while start\n");
         const uint64_t timestamp = currentTimestamp();
 
         //printf("kyle exec while %lld, %llu\n",timestamp, nextUpdate);
-        if (timestamp >= nextUpdate) {
+        // Queued input is handled right away, not at the next deadline
+        if (timestamp >= nextUpdate || Input::hasPendingEvents()) {
+            // Start the update relative to the predicted vsync, so that the
+            // frame is ready just in time for the vsync it is paced at
+            const uint64_t nowUs = clockUs();
+            const uint64_t startUs = framePacer.nextFrameStartUs(nowUs);
+            if (startUs > nowUs + 1000)
+                thread_sleep((startUs - nowUs) / 1000);
+
             // Handle deadline or pending events
             //printf("kyle exec while updateEngine start\n");
-            Qul::PlatformInterface::updateEngine(timestamp);
+            framePacer.frameStarted(clockUs());
+            SDRV_PROFILE_FRAME_BEGIN();
+            // Everything that arrived up to now, in one batch for this update
+            Input::deliverEvents();
+            // The sleep above moved the update closer to its vsync
+            Qul::PlatformInterface::updateEngine(currentTimestamp());
+            SDRV_PROFILE_FRAME_END();
+            runDeferredInit();
         } else {
             // The core library has no pending actions.
-            // The device may go to a sleep mode.
+            // Block until the deadline or until an update is scheduled, input
+            // arrives or G2D completes.
             //printf("kyle exec while sleep %llu\n", nextUpdate - timestamp);
-            // wait_for_interrupt(nextUpdate - timestamp);
-            thread_sleep(nextUpdate - timestamp);
+            waitForEngineWakeup(Wakeup_EngineUpdate | Wakeup_Input | Wakeup_G2D, nextUpdate - timestamp);
+            continue;
         }
         frame++;
         frame = frame%3600;
@@ -356,6 +483,8 @@ void exec()
             printf("fps:%f\n", fps);
             last_time = cur;
         }
+        if (frame == 0)
+            SDRV_PROFILE_REPORT();
         //printf("kyle exec while end\n");
     }
 }
@@ -373,22 +502,25 @@ FrameBufferingType frameBufferingType(const PlatformInterface::Screen *)
 Qul::PlatformInterface::Screen *availableScreens(size_t *screenCount)
 {
     //printf("kyle availableScreens start %d, %d\n", ScreenWidth, ScreenHeight);
-    *screenCount = 1;
-    static PlatformInterface::Screen screen(PlatformInterface::Size(ScreenWidth, ScreenHeight));
+    *screenCount = Screens::count();
     //printf("kyle availableScreens end\n");
-    return &screen;
+    return Screens::all();
 }
 //! [availableScreens]
 
 //! [asyncFunctions]
-void waitUntilAsyncReadFinished(const void * /*begin*/, const void * /*end*/)
+// Only waits for the DMA transfers touching the range, see sdrvdma
+void waitUntilAsyncReadFinished(const void *begin, const void *end)
 {
     // HW_SyncFramebufferForCpuAccess();
+    dmaWaitForRange(begin, end);
 }
 
-void flushCachesForAsyncRead(const void * /*addr*/, size_t /*length*/)
+void flushCachesForAsyncRead(const void *addr, size_t length)
 {
     // CleanInvalidateDCache_by_Addr(const_cast<void *>(addr), length);
+    // DMA and G2D read memory directly, push the CPU writes out of the cache
+    arch_clean_cache_range((addr_t)addr, length);
 }
 //! [asyncFunctions]
 
@@ -410,6 +542,7 @@ public:
                                int sourceOpacity,
                                BlendMode blendMode) override
     {
+        SDRV_PROFILE_SCOPE(Phase_BlendTransformedImage);
         // if (frame%360 == 0) {
         //     printf("kyle destinationRect %f,%f,%f,%f\n", destinationRect.x(), destinationRect.y(),destinationRect.width(),destinationRect.height());
         //     printf("kyle sourceRect %f,%f,%f,%f\n", sourceRect.x(), sourceRect.y(),sourceRect.width(),sourceRect.height());
@@ -441,6 +574,7 @@ public:
                                 int sourceOpacity,
                                 BlendMode blendMode) override
     {
+        SDRV_PROFILE_SCOPE(Phase_BlendImage);
         // if (frame == lastframe) {
         //     return;
         // }
@@ -452,71 +586,35 @@ public:
 
         // printf("kyle pos %d,%d\n", pos.x(), pos.y());
         // printf("kyle sourceRect %d,%d,%d,%d\n", sourceRect.x(), sourceRect.y(),sourceRect.width(),sourceRect.height());
-        if (!already_copy_source) {
-            memcpy(temp, source.data(), 288*288*4);
-            arch_clean_cache_range((addr_t)temp, 288*288*4);
-            already_copy_source = true;
-        }
-
-
-        int x = sourceRect.x();
-        int y = sourceRect.y();
-        int w =  sourceRect.width();
-        int h =  sourceRect.height();
-        // fallbackDrawingEngine()->blendImage(drawingDevice, pos, source, sourceRect, sourceOpacity, blendMode);
-
-        static struct g2dlite_input input;
-        input.layer_num = 2;
-
-        for (int i = 0; i < input.layer_num; i++) {
-            struct g2dlite_input_cfg  *l = &input.layer[i];
-            l->layer_en = 1;
-            l->layer = i;
-            l->fmt = COLOR_ARGB8888;
-            l->zorder = i;
-
-            l->ckey_en = 0;
-
-            l->alpha = 255;
-
-            if (i == 0) {
-                l->blend = BLEND_PIXEL_NONE;
-                l->addr[0] = (unsigned long) (drawingDevice->bits());
-                l->src_x = pos.x();
-                l->src_y = pos.y();
-                l->src_w = w;
-                l->src_h = h;
-                l->src_stride[0] = drawingDevice->width()*4;
-
-                l->dst_x = 0;// canvas :output x y
-                l->dst_y = 0;
-                l->dst_w = w;
-                l->dst_h = h;
+        // Flash-resident textures are read through their RAM copy once cached,
+        // RLE textures are decoded into the cache as G2D cannot read them
+        const unsigned char *sourceData = NULL;
+        int sourceStride = source.bytesPerLine();
+        TextureCache::Decoder decoder = rleDecoder(source.format());
+        const bool blendable = G2DBlit::blendFormat(decoder ? rleDecodedFormat(source.format()) : source.format()) >= 0
+                               && G2DBlit::blendFormat(drawingDevice->format()) >= 0;
+        if (blendable) {
+            if (decoder) {
+                sourceStride = source.width() * 4;
+                const std::size_t size = sourceStride * source.height();
+                sourceData = TextureCache::lookup(source.data(), size, decoder, rleDataSize(source.data(), size));
             } else {
-                l->blend = BLEND_PIXEL_COVERAGE;
-                l->addr[0] = (unsigned long) (temp);
-                l->src_x = x;
-                l->src_y = y;
-                l->src_w = w;
-                l->src_h = h;
-                l->src_stride[0] = source.width()*4;
-
-                l->dst_x = 0;// canvas :output x y
-                l->dst_y = 0;
-                l->dst_w = w;
-                l->dst_h = h;
+                sourceData = TextureCache::lookup(source.data(), sourceStride * source.height());
             }
         }
+        // Formats G2D cannot read, e.g. Alpha8 glyphs, go to the software engine
+        if (!sourceData) {
+            fallbackDrawingEngine()->blendImage(drawingDevice, pos, source, sourceRect, sourceOpacity, blendMode);
+            return;
+        }
 
-        input.output.width = w;
-        input.output.height = h;
-        input.output.fmt = COLOR_ARGB8888;
-        input.output.addr[0] = (unsigned long)(drawingDevice->bits() + pos.y()*drawingDevice->width()*4 + pos.x()*4);
-        //input.output.addr[0] = (unsigned long)(drawingDevice->bits());
-        input.output.stride[0] = drawingDevice->width()*4;
-        input.output.rotation = 0;
-        hal_g2dlite_blend(G2D, &input);
-
+        const OpaqueMap::Source opaqueSource = {source.data(),
+                                                sourceData,
+                                                decoder ? rleDecodedFormat(source.format()) : source.format(),
+                                                source.width(),
+                                                source.height(),
+                                                sourceStride};
+        G2DBlit::blendImage(G2D, drawingDevice, pos, opaqueSource, sourceRect, sourceOpacity, blendMode);
     }
 
     void synchronizeForCpuAccess(PlatformInterface::DrawingDevice *drawingDevice,
@@ -527,6 +625,9 @@ public:
         //     printf("kyle synchronizeForCpuAccess %d,%d,%d,%d\n", rect.x(), rect.y(),rect.width(),rect.height());
         // }
         // framebufferAccessedByCpu = true;
+#if SDRV_TILED_FRAMEBUFFER
+        cpuTiles.markRect(rect);
+#endif
 
         // unsigned char *backBuffer = framebuffer[backBufferIndex];
         // for (int i = 0; i < rect.height(); ++i) {
@@ -546,6 +647,11 @@ static void synchronizeAfterCpuAccess(const PlatformInterface::Rect &rect)
     if (frame%360 == 0) {
         //printf("kyle synchronizeAfterCpuAccess %d,%d,%d,%d\n", rect.x(), rect.y(),rect.width(),rect.height());
     }
+#if SDRV_TILED_FRAMEBUFFER
+    // Only the tiles the CPU wrote, G2D writes do not go through the cache
+    cpuTiles.cleanCache(framebuffer[backBufferIndex], ScreenWidth * BytesPerPixel, BytesPerPixel);
+    cpuTiles.clear();
+#endif
     if (framebufferAccessedByCpu) {
         unsigned char *backBuffer = framebuffer[backBufferIndex];
         for (int i = 0; i < rect.height(); ++i) {
@@ -559,10 +665,48 @@ static void synchronizeAfterCpuAccess(const PlatformInterface::Rect &rect)
 //! [synchronizeAfterCpuAccess]
 
 //! [beginFrame]
-static int requestedRefreshInterval = 1;
-PlatformInterface::DrawingDevice *beginFrame(const PlatformInterface::Screen *,
+#if SDRV_TILED_FRAMEBUFFER
+// Copies a rect of the front buffer into the back buffer with G2D
+static void copyForwardRect(const PlatformInterface::Rect &rect, void *)
+{
+    const int stride = ScreenWidth * BytesPerPixel;
+    const int offset = rect.y() * stride + rect.x() * BytesPerPixel;
+
+    static struct g2dlite_input input;
+    input.layer_num = 1;
+    struct g2dlite_input_cfg *l = &input.layer[0];
+    l->layer_en = 1;
+    l->layer = 0;
+    l->fmt = FRAMEBUFFER_HW_FORMAT;
+    l->zorder = 0;
+    l->ckey_en = 0;
+    l->alpha = 255;
+    l->blend = BLEND_PIXEL_NONE;
+    l->addr[0] = (unsigned long)(framebuffer[!backBufferIndex] + offset);
+    l->src_x = 0;
+    l->src_y = 0;
+    l->src_w = rect.width();
+    l->src_h = rect.height();
+    l->src_stride[0] = stride;
+    l->dst_x = 0;
+    l->dst_y = 0;
+    l->dst_w = rect.width();
+    l->dst_h = rect.height();
+
+    input.output.width = rect.width();
+    input.output.height = rect.height();
+    input.output.fmt = FRAMEBUFFER_HW_FORMAT;
+    input.output.addr[0] = (unsigned long)(framebuffer[backBufferIndex] + offset);
+    input.output.stride[0] = stride;
+    input.output.rotation = 0;
+    G2DLocker g2dLocker;
+    hal_g2dlite_blend(G2D, &input);
+}
+#endif
+
+PlatformInterface::DrawingDevice *beginFrame(const PlatformInterface::Screen *screen,
                                              int /*layer*/,
-                                             const PlatformInterface::Rect &,
+                                             const PlatformInterface::Rect &rect,
                                              int refreshInterval)
 {
 #if USE_HW_ACC
@@ -570,15 +714,62 @@ PlatformInterface::DrawingDevice *beginFrame(const PlatformInterface::Screen *,
 #else
     static PlatformInterface::DrawingEngine drawingEngine;
 #endif
+    SDRV_PROFILE_SCOPE(Phase_BeginFrame);
     //printf("kyle beginFrame start %d\n", backBufferIndex);
-    requestedRefreshInterval = refreshInterval;
+    // Drawing a further screen without layers would overwrite the first one
+    if (!isFramebufferScreen(screen)) {
+        static bool reported = false;
+        if (!reported) {
+            printf("beginFrame: screen %d has no framebuffer, its frames are skipped\n", Screens::indexOf(screen));
+            reported = true;
+        }
+        return NULL;
+    }
+    static bool firstFrame = true;
+    if (firstFrame) {
+        bootMark("first beginFrame");
+        firstFrame = false;
+    }
+    framePacer.setRequestedInterval(refreshInterval);
 
     // Wait until the back buffer is free, i.e. no longer held by the display
     //waitForBufferFlip();
 
-    // A pointer to the back buffer
+    // A pointer to the back buffer, allocated on first use
+    framebuffer[backBufferIndex] = acquireScreenBuffer(ScreenBufferUser_Framebuffer,
+                                                       0,
+                                                       backBufferIndex,
+                                                       BytesPerPixel * ScreenWidth * ScreenHeight);
+    frameSkipped = false;
+    bool drawingIntoFront = false;
+    if (!framebuffer[backBufferIndex]) {
+        if (!framebuffer[!backBufferIndex]) {
+            printf("beginFrame: no memory for a framebuffer, skipping the frame\n");
+            frameSkipped = true;
+            return NULL;
+        }
+        // Draw over the shown buffer instead, it may tear but is complete
+        printf("beginFrame: no memory for the back buffer, drawing into the front buffer\n");
+        backBufferIndex = !backBufferIndex;
+        drawingIntoFront = true;
+#if SDRV_TILED_FRAMEBUFFER
+        // Whatever the other buffer gets next lacks the whole screen
+        presentedTiles.markRect(PlatformInterface::Rect(0, 0, ScreenWidth, ScreenHeight));
+#endif
+    }
     uchar *bits = framebuffer[backBufferIndex];
-    static PlatformInterface::DrawingDevice buffer = {Qul::PixelFormat_ARGB32,
+#if SDRV_TILED_FRAMEBUFFER
+    // Qul only redraws rect, bring the rest of the back buffer up to date
+    if (!drawingIntoFront) {
+        presentedTiles.subtractRect(rect);
+        if (framebuffer[!backBufferIndex])
+            presentedTiles.forEachRun(copyForwardRect, NULL);
+        presentedTiles.clear();
+    }
+#else
+    (void) drawingIntoFront;
+#endif
+    static PlatformInterface::DrawingDevice buffer = {FRAMEBUFFER_PIXEL_FORMAT,
                                                       PlatformInterface::Size(ScreenWidth, ScreenHeight),
                                                       bits,
                                                       ScreenWidth * BytesPerPixel,
@@ -594,15 +785,31 @@ PlatformInterface::DrawingDevice *beginFrame(const PlatformInterface::Screen *,
 void endFrame(const PlatformInterface::Screen *) {}
 //! [endFrame]
 
+void releaseFramebuffers()
+{
+    if (!framebuffer[0] && !framebuffer[1])
+        return;
+    releaseScreenBuffers(ScreenBufferUser_Framebuffer, 0);
+    framebuffer[0] = framebuffer[1] = NULL;
+}
+
 //! [waitForRefreshInterval]
 static void waitForRefreshInterval()
 {
     //printf("kyle waitForRefreshInterval start\n");
-    if (refreshCount < requestedRefreshInterval) {
+    SDRV_PROFILE_SCOPE(Phase_VsyncWait);
+    const int interval = framePacer.refreshInterval();
+    if (refreshCount < interval) {
         uint64_t startTime = currentTimestamp();
-        while (refreshCount < requestedRefreshInterval) {
+        waitingForVsync = true;
+        while (refreshCount < interval) {
             //waitForInterrupt(REFRESH_INTERRUPT, 1);
+            if (!waitForEngineWakeup(Wakeup_Vsync, VSYNC_TIMEOUT_MS)) {
+                printf("waitForRefreshInterval: no refresh interrupt\n");
+                break;
+            }
         }
+        waitingForVsync = false;
         idleTimeWaitingForDisplay += currentTimestamp() - startTime;
     }
     //printf("kyle waitForRefreshInterval end\n");
@@ -611,19 +818,29 @@ static void waitForRefreshInterval()
 //! [waitForRefreshInterval]
 
 //! [presentFrame]
-FrameStatistics presentFrame(const PlatformInterface::Screen *, const PlatformInterface::Rect &rect)
+FrameStatistics presentFrame(const PlatformInterface::Screen *screen, const PlatformInterface::Rect &rect)
 {
+    // Nothing was drawn for it, see beginFrame
+    if (!isFramebufferScreen(screen) || frameSkipped)
+        return FrameStatistics();
+
     // HW_SyncFramebufferForCpuAccess();
     //printf("kyle presentFrame start\n");
-    synchronizeAfterCpuAccess(rect);
-    framebufferAccessedByCpu = false;
+    {
+        SDRV_PROFILE_SCOPE(Phase_EndFrame);
+        synchronizeAfterCpuAccess(rect);
+        framebufferAccessedByCpu = false;
+    }
     //printf("kyle presentFrame 111\n");
+    framePacer.frameRendered(clockUs());
     //! [frameSkipCompensation]
     FrameStatistics stats;
-    stats.refreshDelta = refreshCount - requestedRefreshInterval;
-    //waitForRefreshInterval();
-    static const int RefreshRate = 60; // screen refresh rate in Hz
-    stats.remainingBudget = idleTimeWaitingForDisplay + stats.refreshDelta * int(1000.0f / RefreshRate);
+    stats.refreshDelta = refreshCount - framePacer.refreshInterval();
+    // Only pace on the refresh count once the vsync interrupt is known to run
+    if (framePacer.hasVsync())
+        waitForRefreshInterval();
+    // Measured refresh period instead of an assumed 60 Hz
+    stats.remainingBudget = idleTimeWaitingForDisplay + stats.refreshDelta * int(framePacer.refreshPeriodUs() / 1000);
     //! [frameSkipCompensation]
     //printf("kyle presentFrame sdm_post start, %d\n", backBufferIndex);
     waitingForBufferFlip = true;
@@ -634,10 +851,18 @@ FrameStatistics presentFrame(const PlatformInterface::Screen *, const PlatformIn
     // Now we can update the framebuffer address
     // LCD_SetBufferAddr(framebuffer[backBufferIndex]);
     //printf("kyle sdm post bits 0x%x, 0x%x, 0x%x, 0x%x\n", framebuffer[backBufferIndex][0], framebuffer[backBufferIndex][1], framebuffer[backBufferIndex][2], framebuffer[backBufferIndex][3]);
+#if SDRV_TILED_FRAMEBUFFER
+    presentedTiles.markRect(rect);
+#endif
     sdm_buf.addr[0] = (unsigned long)framebuffer[backBufferIndex];
     post_data.bufs             = &sdm_buf;
     post_data.n_bufs           = 1;
-    sdm_post(m_sdm->handle, &post_data);
+    {
+        SDRV_PROFILE_SCOPE(Phase_Post);
+        sdm_post(m_sdm->handle, &post_data);
+    }
+    framePacer.framePresented(clockUs());
+    bootFramePresented();
     //printf("kyle presentFrame sdm_post end\n");
     // Now the front and back buffers are swapped
     if (backBufferIndex == 0)
@@ -649,321 +874,6 @@ FrameStatistics presentFrame(const PlatformInterface::Screen *, const PlatformIn
     return stats;
 }
 //! [presentFrame]
-#if 0
-namespace Private {
 
-//! [singleTouchInputDispatcherEventQueue]
-class SinglePointTouchEventQueue : public Qul::EventQueue<Qul::Platform::SinglePointTouchEvent>
-{
-public:
-    void onEvent(const Qul::Platform::SinglePointTouchEvent &event) override { touchEventDispatcher.dispatch(event); }
-
-private:
-    Qul::Platform::SinglePointTouchEventDispatcher touchEventDispatcher;
-};
-
-static SinglePointTouchEventQueue touchEventQueue;
-//! [singleTouchInputDispatcherEventQueue]
-
-//! [singleTouchInputDispatcherEventGetter]
-Qul::Platform::SinglePointTouchEvent getTouchEvent()
-{
-    static Qul::Platform::SinglePointTouchEvent event;
-    int x = 0, y = 0;
-    bool pressed = false;
-
-    // Here would be platform specific code to fetch touch data and store it to above x, y and
-    // pressed variables or directly to the event variable.
-
-    event.x = x;
-    event.y = y;
-    event.pressed = pressed;
-    event.timestamp = Qul::Platform::currentTimestamp();
-
-    return event;
-}
-//! [singleTouchInputDispatcherEventGetter]
-
-//! [singleTouchInputDispatcherISR]
-void touchISR()
-{
-    touchEventQueue.postEvent(getTouchEvent());
-}
-//! [singleTouchInputDispatcherISR]
-
-//! [singleTouchInputEventQueue]
-class TouchPointEventQueue : public Qul::EventQueue<Qul::PlatformInterface::TouchPoint>
-{
-public:
-    void onEvent(const Qul::PlatformInterface::TouchPoint &point) override
-    {
-        Qul::PlatformInterface::handleTouchEvent(nullptr, /* Primary screen will be used */
-                                                 Qul::Platform::currentTimestamp(),
-                                                 &point,
-                                                 1); /* only one touch point */
-    }
-};
-
-static TouchPointEventQueue touchPointQueue;
-
-void touchEventISR()
-{
-    static Qul::PlatformInterface::TouchPoint point;
-
-    // Here would be code to fetch platform specific touch data and store it into point variable.
-    // To keep the example simple we just send constant data.
-    point.id = 0;
-    point.state = Qul::PlatformInterface::TouchPoint::Stationary;
-    point.positionX = 100;
-    point.positionY = 100;
-    point.areaX = 1.f;
-    point.areaY = 1.f;
-    point.pressure = 0.1f;
-    point.rotation = 1.f;
-    touchPointQueue.postEvent(point);
-}
-//! [singleTouchInputEventQueue]
-
-//! [multiTouchInput]
-// These are just dummy handles for the example
-Qul::PlatformInterface::Screen primaryScreenHandle;
-Qul::PlatformInterface::Screen secondaryScreenHandle;
-
-// multi-touch with 2 touch points
-const int numTouchPoints = 2;
-struct TouchPoints
-{
-    Qul::PlatformInterface::TouchPoint points[numTouchPoints];
-};
-
-class PlatformTouchEventQueue : public Qul::EventQueue<TouchPoints>
-{
-public:
-    PlatformTouchEventQueue(Qul::PlatformInterface::Screen *s)
-        : screen(s)
-    {}
-
-    void onEvent(const TouchPoints &p) override
-    {
-        Qul::PlatformInterface::handleTouchEvent(screen, Qul::Platform::currentTimestamp(), p.points, numTouchPoints);
-    }
-
-private:
-    Qul::PlatformInterface::Screen *screen;
-};
-
-static PlatformTouchEventQueue primaryScreenTouchEventQueue(&primaryScreenHandle);
-static PlatformTouchEventQueue secondaryScreenTouchEventQueue(&secondaryScreenHandle);
-
-void primaryTouchISR()
-{
-    static TouchPoints p;
-
-    // Here would be platform specific code to fetch touch data for primary screen. To keep the
-    // example simple we just send constant data.
-
-    for (int i = 0; i < numTouchPoints; i++) {
-        p.points[i].id = i;
-        p.points[i].state = Qul::PlatformInterface::TouchPoint::Stationary;
-        p.points[i].positionX = 100;
-        p.points[i].positionY = 100;
-        p.points[i].areaX = 1.f;
-        p.points[i].areaY = 1.f;
-        p.points[i].pressure = 0.1f;
-        p.points[i].rotation = 1.f;
-    }
-    primaryScreenTouchEventQueue.postEvent(p);
-}
-
-void secondaryTouchISR()
-{
-    static TouchPoints p;
-
-    // Here would be platform specific code to fetch touch data for secondary screen. To keep the
-    // example simple we just send constant data.
-
-    for (int i = 0; i < numTouchPoints; i++) {
-        p.points[i].id = i;
-        p.points[i].state = Qul::PlatformInterface::TouchPoint::Stationary;
-        p.points[i].positionX = 150;
-        p.points[i].positionY = 150;
-        p.points[i].areaX = 0.5f;
-        p.points[i].areaY = 0.5f;
-        p.points[i].pressure = 0.5f;
-        p.points[i].rotation = 2.f;
-    }
-    secondaryScreenTouchEventQueue.postEvent(p);
-}
-//! [multiTouchInput]
-
-//! [keyInput]
-struct KeyboardEvent
-{
-    uint64_t timestamp;
-    Qul::PlatformInterface::KeyEventType type;
-    int key;
-    unsigned int nativeScanCode;
-    unsigned int modifiers;
-    char *textUTF;
-    bool autorepeat;
-};
-
-class PlatformKeyboardEventQueue : public Qul::EventQueue<KeyboardEvent>
-{
-    void onEvent(const KeyboardEvent &event) override
-    {
-        Qul::PlatformInterface::handleKeyEvent(event.timestamp,
-                                               event.type,
-                                               event.key,
-                                               event.nativeScanCode,
-                                               event.modifiers,
-                                               event.textUTF,
-                                               event.autorepeat);
-    }
-};
-
-static PlatformKeyboardEventQueue keyboardEventQueue;
-
-void keyboardISR()
-{
-    // Here would be platform specific code to fetch data from the keyboard.
-    static KeyboardEvent event;
-    event.timestamp = Qul::Platform::currentTimestamp();
-    event.type = Qul::PlatformInterface::KeyPressEvent;
-    event.key = Qul::PlatformInterface::Key_A;
-    event.nativeScanCode = 0;
-    event.modifiers = Qul::PlatformInterface::NoKeyboardModifier;
-    event.textUTF = (char *) "A"; /* UTF-8 representation */
-    event.autorepeat = false;
-
-    keyboardEventQueue.postEvent(event);
-}
-//! [keyInput]
-
-//! [customInputTemperatureInterface]
-struct TemperatureInput : public Qul::Singleton<TemperatureInput>, public Qul::EventQueue<double>
-{
-    Qul::Signal<void(double value)> temperatureChanged;
-
-    enum Unit { Celsius, Fahrenheit, Kelvin };
-    Qul::Property<TemperatureInput::Unit> unit;
-    void setUnit(TemperatureInput::Unit newUnit)
-    {
-        switch (unit.value()) {
-        case Celsius:
-            if (newUnit == Celsius)
-                return;
-            newUnit == Kelvin ? cachedValue += 273.15 : cachedValue = cachedValue * 1.8 + 32.0;
-            break;
-        case Fahrenheit:
-            if (newUnit == Fahrenheit)
-                return;
-            newUnit == Kelvin ? cachedValue = (cachedValue - 32.0) / 1.8 + 273.15
-                              : cachedValue = (cachedValue - 32.0) / 1.8;
-            break;
-        case Kelvin:
-            if (newUnit == Kelvin)
-                return;
-            newUnit == Celsius ? cachedValue -= 273.15 : cachedValue = (cachedValue - 273.15) * 1.8 + 32.0;
-            break;
-        }
-        unit.setValue(newUnit);
-        temperatureChanged(cachedValue);
-    }
-
-    void onEvent(const double &temperature) override
-    {
-        temperatureChanged(temperature);
-        cachedValue = temperature;
-    }
-
-private:
-    // Create friendship for a base class to be able to access private constructor
-    friend class Qul::Singleton<TemperatureInput>;
-    TemperatureInput() {}
-    TemperatureInput(const TemperatureInput &);
-    TemperatureInput &operator=(const TemperatureInput &);
-
-    double cachedValue;
-};
-//! [customInputTemperatureInterface]
-
-//! [customInputTemperatureSend]
-void temperatureSensorISR()
-{
-    // Here would be platform specific code to read temperature sensor value.
-
-    switch (TemperatureInput::instance().unit.value()) {
-    case TemperatureInput::Celsius:
-        TemperatureInput::instance().postEvent(30.0);
-        break;
-    case TemperatureInput::Fahrenheit:
-        TemperatureInput::instance().postEvent(86.0);
-        break;
-    case TemperatureInput::Kelvin:
-        TemperatureInput::instance().postEvent(303.15);
-        break;
-    default:
-        assert(!"Unknown temperature unit requested!");
-    }
-}
-//! [customInputTemperatureSend]
-
-//! [customInputKnobEvent]
-struct RotaryKnobInputEvent : public Qul::Object
-{
-    enum Action : int { NudgeDown, NudgeUp, NudgeLeft, NudgeRight, Push, Back, RotateLeft, RotateRight };
-
-    enum ActionState : int { ActionStart, ActionRepeat, ActionStop };
-
-    RotaryKnobInputEvent(Action action, ActionState state)
-        : action(action)
-        , actionState(state)
-    {}
-
-    Action action;
-    ActionState actionState;
-};
-//! [customInputKnobEvent]
-
-//! [customInputKnobInterface]
-struct RotaryKnobInput : public Qul::Singleton<RotaryKnobInput>, public Qul::EventQueue<RotaryKnobInputEvent>
-{
-    Qul::Signal<void(int action, int state)> rotaryKnobEvent;
-
-    void onEvent(const RotaryKnobInputEvent &event) override { rotaryKnobEvent(event.action, event.actionState); }
-
-private:
-    // Create friendship for a base class to be able to access private constructor
-    friend class Qul::Singleton<RotaryKnobInput>;
-    RotaryKnobInput() {}
-    RotaryKnobInput(const RotaryKnobInput &);
-    RotaryKnobInput &operator=(const RotaryKnobInput &);
-};
-//! [customInputKnobInterface]
-
-//! [customInputKnobISR]
-void rotaryKnobISR()
-{
-    // Here would be platform specific code to read state from rotary knob device.
-
-    static int action = RotaryKnobInputEvent::ActionStart;
-    static int state = RotaryKnobInputEvent::NudgeDown;
-
-    RotaryKnobInput::instance().postEvent(
-        RotaryKnobInputEvent(RotaryKnobInputEvent::Action(action), RotaryKnobInputEvent::ActionState(state)));
-
-    if (++state > RotaryKnobInputEvent::ActionStop) {
-        state = RotaryKnobInputEvent::ActionStart;
-
-        if (++action > RotaryKnobInputEvent::RotateRight)
-            action = RotaryKnobInputEvent::NudgeDown;
-    }
-}
-//! [customInputKnobISR]
-
-} // namespace Private
-
-#endif
 } // namespace Platform
 } // namespace Qul
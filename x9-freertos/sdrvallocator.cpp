@@ -0,0 +1,628 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvallocator.h"
+
+#ifdef __cplusplus
+extern "C" {
+    #include "heap.h"
+}
+#endif
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <config.h>
+#include <lk_wrapper.h>
+
+#if SDRV_MEM_TRACKING
+#include "sdrvclock.h"
+#endif
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace Qul {
+namespace Platform {
+namespace Allocator {
+
+#define SLAB_PAGE_SIZE       0x1000
+#define SLAB_CHUNK_SIZE      0x10000
+#define SLAB_MAX_CHUNKS      16
+#define SLAB_PAGES_PER_CHUNK (SLAB_CHUNK_SIZE / SLAB_PAGE_SIZE)
+#define SLAB_PAGE_UNUSED     0xff
+#define CACHE_LINE_SIZE      64
+#define LARGE_BLOCK_MAGIC    0x51554c42
+
+static const uint16_t classSizes[] = {16, 32, 48, 64, 96, 128, 192, 256, 384, 512};
+static const int ClassCount = sizeof(classSizes) / sizeof(classSizes[0]);
+
+struct FreeBlock
+{
+    FreeBlock *next;
+};
+
+// Slabs of Memory_CpuHot blocks only take chunks from the hot pool, the
+// default ones only from the SDK heap
+enum SlabArena {
+    Arena_Default = 0,
+    Arena_Hot,
+    Arena_Count
+};
+
+// 64 KB arena chunk, split into 4 KB pages that each hold one size class
+struct SlabChunk
+{
+    unsigned char *base;
+    uint8_t arena;
+    uint8_t pageClass[SLAB_PAGES_PER_CHUNK];
+};
+
+// Stored right in front of every large block
+struct LargeHeader
+{
+    uint32_t magic;
+    uint32_t offset;   /* from the SDK block start to the user pointer */
+    uint32_t size;
+    uint32_t capacity;
+    uint32_t region;
+};
+
+enum Region {
+    Region_Sram = 0,      /* hot pool */
+    Region_CpuHeap,       /* SDK heap, slab chunks and CPU blocks */
+    Region_HardwareHeap,  /* SDK heap, scanout and G2D buffers */
+    Region_Count
+};
+
+struct RegionStats
+{
+    std::size_t currentBytes;
+    std::size_t peakBytes;
+    uint32_t blocks;
+};
+
+struct ClassStats
+{
+    uint32_t inUse;
+    uint32_t peakInUse;
+    uint32_t allocations;
+};
+
+static const char *const regionNames[Region_Count] = {"sram", "heap cpu", "heap hw"};
+static RegionStats regionStats[Region_Count];
+static ClassStats classStats[ClassCount];
+static uint32_t slabPages = 0;
+
+#if SDRV_HOT_POOL_SIZE
+// Lives in .bss, which the linker places in internal SRAM
+static unsigned char hotPool[SDRV_HOT_POOL_SIZE] __attribute__((aligned(SLAB_PAGE_SIZE)));
+#endif
+static std::size_t hotPoolUsed = 0;
+
+static FreeBlock *freeLists[Arena_Count][ClassCount];
+static SlabChunk chunks[SLAB_MAX_CHUNKS];
+static int chunkCount = 0;
+static int lastChunk[Arena_Count];
+static int usedPagesInLastChunk[Arena_Count] = {SLAB_PAGES_PER_CHUNK, SLAB_PAGES_PER_CHUNK};
+static uint8_t sizeToClass[SDRV_SLAB_MAX_SIZE / 16 + 1];
+static bool initialized = false;
+
+// Callers hold the scheduler lock
+static void account(Region region, long bytes)
+{
+    RegionStats &stats = regionStats[region];
+    stats.currentBytes += bytes;
+    stats.blocks += bytes > 0 ? 1 : -1;
+    if (stats.currentBytes > stats.peakBytes)
+        stats.peakBytes = stats.currentBytes;
+}
+
+static void init()
+{
+    int index = 0;
+    for (int i = 0; i <= SDRV_SLAB_MAX_SIZE / 16; ++i) {
+        while (classSizes[index] < i * 16)
+            ++index;
+        sizeToClass[i] = index;
+    }
+    initialized = true;
+}
+
+static inline int classIndex(std::size_t size)
+{
+    return sizeToClass[(size + 15) / 16];
+}
+
+// Finds the chunk holding ptr, or NULL if ptr is not a slab block
+static SlabChunk *findChunk(const void *ptr)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(ptr);
+    for (int i = 0; i < chunkCount; ++i) {
+        if (p >= chunks[i].base && p < chunks[i].base + SLAB_CHUNK_SIZE)
+            return &chunks[i];
+    }
+    return NULL;
+}
+
+// New chunk for the arena, NULL once the hot pool or the SDK heap is used up
+static unsigned char *takeSlabChunk(SlabArena arena)
+{
+    if (arena == Arena_Hot) {
+#if SDRV_HOT_POOL_SIZE
+        if (hotPoolUsed + SLAB_CHUNK_SIZE <= SDRV_HOT_POOL_SIZE) {
+            unsigned char *base = hotPool + hotPoolUsed;
+            hotPoolUsed += SLAB_CHUNK_SIZE;
+            account(Region_Sram, SLAB_CHUNK_SIZE);
+            return base;
+        }
+#endif
+        return NULL;
+    }
+
+    unsigned char *base = (unsigned char *)malloc(SLAB_PAGE_SIZE, SLAB_CHUNK_SIZE);
+    if (base)
+        account(Region_CpuHeap, SLAB_CHUNK_SIZE);
+    return base;
+}
+
+static unsigned char *takeSlabPage(SlabArena arena, int cls)
+{
+    if (usedPagesInLastChunk[arena] == SLAB_PAGES_PER_CHUNK) {
+        if (chunkCount == SLAB_MAX_CHUNKS)
+            return NULL;
+        unsigned char *base = takeSlabChunk(arena);
+        if (!base)
+            return NULL;
+        chunks[chunkCount].base = base;
+        chunks[chunkCount].arena = arena;
+        for (int i = 0; i < SLAB_PAGES_PER_CHUNK; ++i)
+            chunks[chunkCount].pageClass[i] = SLAB_PAGE_UNUSED;
+        lastChunk[arena] = chunkCount++;
+        usedPagesInLastChunk[arena] = 0;
+    }
+
+    SlabChunk &chunk = chunks[lastChunk[arena]];
+    chunk.pageClass[usedPagesInLastChunk[arena]] = cls;
+    ++slabPages;
+    return chunk.base + SLAB_PAGE_SIZE * usedPagesInLastChunk[arena]++;
+}
+
+// Pops a block of class cls, carving a new page into the free list if needed
+static void *slabAllocate(SlabArena arena, int cls)
+{
+    FreeBlock *&freeList = freeLists[arena][cls];
+    if (!freeList) {
+        unsigned char *page = takeSlabPage(arena, cls);
+        if (!page)
+            return NULL;
+        const int blockSize = classSizes[cls];
+        FreeBlock *head = NULL;
+        for (int offset = SLAB_PAGE_SIZE - blockSize; offset >= 0; offset -= blockSize) {
+            FreeBlock *block = reinterpret_cast<FreeBlock *>(page + offset);
+            block->next = head;
+            head = block;
+        }
+        freeList = head;
+    }
+
+    FreeBlock *block = freeList;
+    freeList = block->next;
+
+    ClassStats &stats = classStats[cls];
+    ++stats.allocations;
+    if (++stats.inUse > stats.peakInUse)
+        stats.peakInUse = stats.inUse;
+    return block;
+}
+
+static bool isHardwareType(MemoryType type)
+{
+    return type == Memory_Scanout || type == Memory_G2DScratch;
+}
+
+// slack is extra capacity kept behind the block so that growing it again stays in place
+static void *largeAllocate(std::size_t size, std::size_t slack = 0, MemoryType type = Memory_CpuDefault)
+{
+    const std::size_t align = size >= SDRV_PAGE_ALIGN_MIN_SIZE || isHardwareType(type) ? SLAB_PAGE_SIZE
+                                                                                       : CACHE_LINE_SIZE;
+    const std::size_t capacity = (size + slack + CACHE_LINE_SIZE - 1) & ~std::size_t(CACHE_LINE_SIZE - 1);
+
+    // The header takes one alignment unit so that the user pointer stays aligned
+    unsigned char *base = (unsigned char *)malloc(align, capacity + align);
+    if (!base) {
+        printf("qul_malloc: out of memory, size %u\n", (unsigned)size);
+        return NULL;
+    }
+
+    unsigned char *ptr = base + align;
+    if (isHardwareType(type)) {
+        // DC and G2D only reach external DDR
+        if ((addr_t)base < EXT_MEM_BASE || (addr_t)base + capacity + align - EXT_MEM_BASE > EXT_MEM_SIZE) {
+            printf("qul_malloc: hardware buffer %p outside external memory, size %u\n", ptr, (unsigned)size);
+            efree(base);
+            return NULL;
+        }
+        // Dirty lines left by the previous owner of this memory must not be
+        // evicted on top of what DC or G2D read and write later
+        arch_clean_invalidate_cache_range((addr_t)ptr, capacity);
+    }
+
+    LargeHeader *header = reinterpret_cast<LargeHeader *>(ptr) - 1;
+    header->magic = LARGE_BLOCK_MAGIC;
+    header->offset = align;
+    header->size = size;
+    header->capacity = capacity;
+    header->region = isHardwareType(type) ? Region_HardwareHeap : Region_CpuHeap;
+
+    vTaskSuspendAll();
+    account(Region(header->region), capacity + align);
+    xTaskResumeAll();
+    return ptr;
+}
+
+static LargeHeader *largeHeader(const void *ptr)
+{
+    LargeHeader *header = reinterpret_cast<LargeHeader *>(const_cast<void *>(ptr)) - 1;
+    if (header->magic != LARGE_BLOCK_MAGIC) {
+        printf("qul_free: invalid pointer %p\n", ptr);
+        return NULL;
+    }
+    return header;
+}
+
+static void *allocateBlock(std::size_t size, MemoryType type)
+{
+    if (size > SDRV_SLAB_MAX_SIZE || isHardwareType(type))
+        return largeAllocate(size, 0, type);
+
+    vTaskSuspendAll();
+    if (!initialized)
+        init();
+    const int cls = classIndex(size);
+    void *ptr = NULL;
+    // Once the hot pool is used up hot blocks are ordinary ones
+    if (type == Memory_CpuHot)
+        ptr = slabAllocate(Arena_Hot, cls);
+    if (!ptr)
+        ptr = slabAllocate(Arena_Default, cls);
+    xTaskResumeAll();
+
+    // Slab arena exhausted, fall back to a large block
+    return ptr ? ptr : largeAllocate(size);
+}
+
+static void releaseBlock(void *ptr)
+{
+    vTaskSuspendAll();
+    SlabChunk *chunk = findChunk(ptr);
+    if (chunk) {
+        const int page = (static_cast<unsigned char *>(ptr) - chunk->base) / SLAB_PAGE_SIZE;
+        const int cls = chunk->pageClass[page];
+        FreeBlock *block = static_cast<FreeBlock *>(ptr);
+        block->next = freeLists[chunk->arena][cls];
+        freeLists[chunk->arena][cls] = block;
+        --classStats[cls].inUse;
+    }
+    xTaskResumeAll();
+
+    if (chunk)
+        return;
+
+    LargeHeader *header = largeHeader(ptr);
+    if (!header)
+        return;
+    header->magic = 0;
+    vTaskSuspendAll();
+    account(Region(header->region), -long(header->capacity + header->offset));
+    xTaskResumeAll();
+    efree(static_cast<unsigned char *>(ptr) - header->offset);
+}
+
+// A moved block is copied, the caller releases the old one
+static void *reallocateBlock(void *ptr, std::size_t size)
+{
+    std::size_t oldSize = 0;
+    vTaskSuspendAll();
+    SlabChunk *chunk = findChunk(ptr);
+    if (chunk)
+        oldSize = classSizes[chunk->pageClass[(static_cast<unsigned char *>(ptr) - chunk->base) / SLAB_PAGE_SIZE]];
+    xTaskResumeAll();
+
+    if (!chunk) {
+        LargeHeader *header = largeHeader(ptr);
+        if (!header)
+            return NULL;
+        // Shrinking, or growing into the capacity slack
+        if (size > SDRV_SLAB_MAX_SIZE && size <= header->capacity) {
+            header->size = size;
+            return ptr;
+        }
+        oldSize = header->size;
+    } else if (size <= oldSize) {
+        return ptr;
+    }
+
+    // Grown blocks get a quarter of slack, so that appending to strings and
+    // models does not move them on every call. Hot slab blocks stay hot.
+    const MemoryType type = chunk && chunk->arena == Arena_Hot ? Memory_CpuHot : Memory_CpuDefault;
+    void *newPtr = size > oldSize && size > SDRV_SLAB_MAX_SIZE ? largeAllocate(size, size / 4)
+                                                                           : allocateBlock(size, type);
+    if (!newPtr)
+        return NULL;
+    memcpy(newPtr, ptr, oldSize < size ? oldSize : size);
+    return newPtr;
+}
+
+#if SDRV_MEM_TRACKING
+
+struct TrackingRecord
+{
+    void *ptr;              /* NULL marks an empty slot */
+    const void *callSite;
+    uint32_t size;
+    uint32_t serial;        /* allocation order, compared against marks */
+    uint32_t timestampMs;
+};
+
+// Open addressing table of live allocations, power of two sized
+static TrackingRecord records[SDRV_MEM_TRACKING_SLOTS];
+static uint32_t trackingSerial = 0;
+static uint32_t trackedCount = 0;
+static uint32_t untrackedCount = 0;
+
+static inline uint32_t slotOf(const void *ptr)
+{
+    return ((uint32_t)(uintptr_t)ptr >> 4) * 2654435761u & (SDRV_MEM_TRACKING_SLOTS - 1);
+}
+
+static void trackAdd(void *ptr, std::size_t size, const void *callSite)
+{
+    const uint32_t timestampMs = uint32_t(clockMs());
+
+    vTaskSuspendAll();
+    if (trackedCount + 1 >= SDRV_MEM_TRACKING_SLOTS) {
+        ++untrackedCount;
+    } else {
+        uint32_t slot = slotOf(ptr);
+        while (records[slot].ptr)
+            slot = (slot + 1) & (SDRV_MEM_TRACKING_SLOTS - 1);
+        TrackingRecord &record = records[slot];
+        record.ptr = ptr;
+        record.callSite = callSite;
+        record.size = size;
+        record.serial = ++trackingSerial;
+        record.timestampMs = timestampMs;
+        ++trackedCount;
+    }
+    xTaskResumeAll();
+}
+
+static void trackRemove(void *ptr)
+{
+    vTaskSuspendAll();
+    uint32_t slot = slotOf(ptr);
+    while (records[slot].ptr && records[slot].ptr != ptr)
+        slot = (slot + 1) & (SDRV_MEM_TRACKING_SLOTS - 1);
+
+    if (records[slot].ptr) {
+        // Backward shift deletion keeps probe chains intact without tombstones
+        uint32_t hole = slot;
+        uint32_t next = (hole + 1) & (SDRV_MEM_TRACKING_SLOTS - 1);
+        while (records[next].ptr) {
+            const uint32_t home = slotOf(records[next].ptr);
+            if (((next - home) & (SDRV_MEM_TRACKING_SLOTS - 1)) >= ((next - hole) & (SDRV_MEM_TRACKING_SLOTS - 1))) {
+                records[hole] = records[next];
+                hole = next;
+            }
+            next = (next + 1) & (SDRV_MEM_TRACKING_SLOTS - 1);
+        }
+        records[hole].ptr = NULL;
+        --trackedCount;
+    }
+    xTaskResumeAll();
+}
+
+uint32_t trackingMark()
+{
+    vTaskSuspendAll();
+    const uint32_t mark = trackingSerial;
+    xTaskResumeAll();
+    return mark;
+}
+
+uint32_t liveAllocationsSince(uint32_t mark, std::size_t *bytes)
+{
+    uint32_t blocks = 0;
+    std::size_t total = 0;
+    vTaskSuspendAll();
+    for (int i = 0; i < SDRV_MEM_TRACKING_SLOTS; ++i) {
+        if (records[i].ptr && records[i].serial > mark) {
+            ++blocks;
+            total += records[i].size;
+        }
+    }
+    xTaskResumeAll();
+    if (bytes)
+        *bytes = total;
+    return blocks;
+}
+
+void printAllocationsSince(uint32_t mark)
+{
+    struct Site
+    {
+        const void *callSite;
+        uint32_t blocks;
+        uint32_t bytes;
+        uint32_t oldestMs;
+    };
+    static Site sites[SDRV_MEM_TRACKING_SITES];
+    int siteCount = 0;
+    uint32_t blocks = 0;
+    uint32_t bytes = 0;
+
+    vTaskSuspendAll();
+    for (int i = 0; i < SDRV_MEM_TRACKING_SLOTS; ++i) {
+        const TrackingRecord &record = records[i];
+        if (!record.ptr || record.serial <= mark)
+            continue;
+        ++blocks;
+        bytes += record.size;
+
+        int site = 0;
+        while (site < siteCount && sites[site].callSite != record.callSite)
+            ++site;
+        if (site == siteCount) {
+            if (siteCount == SDRV_MEM_TRACKING_SITES)
+                continue;
+            sites[site].callSite = record.callSite;
+            sites[site].blocks = 0;
+            sites[site].bytes = 0;
+            sites[site].oldestMs = record.timestampMs;
+            ++siteCount;
+        }
+        ++sites[site].blocks;
+        sites[site].bytes += record.size;
+        if (record.timestampMs < sites[site].oldestMs)
+            sites[site].oldestMs = record.timestampMs;
+    }
+    const uint32_t untracked = untrackedCount;
+    xTaskResumeAll();
+
+    printf("memtrack: %u blocks, %u bytes allocated since mark %u still live\n",
+           (unsigned)blocks, (unsigned)bytes, (unsigned)mark);
+    for (int i = 0; i < siteCount; ++i) {
+        printf("memtrack: site %p: %u blocks, %u bytes, oldest at %u ms\n",
+               sites[i].callSite,
+               (unsigned)sites[i].blocks,
+               (unsigned)sites[i].bytes,
+               (unsigned)sites[i].oldestMs);
+    }
+    if (untracked)
+        printf("memtrack: %u allocations not tracked, table full\n", (unsigned)untracked);
+}
+
+#else
+
+static inline void trackAdd(void *, std::size_t, const void *) {}
+static inline void trackRemove(void *) {}
+
+#endif // SDRV_MEM_TRACKING
+
+void *allocate(std::size_t size, MemoryType type, const void *callSite)
+{
+    void *ptr = allocateBlock(size, type);
+    if (ptr)
+        trackAdd(ptr, size, callSite ? callSite : __builtin_return_address(0));
+    return ptr;
+}
+
+void release(void *ptr)
+{
+    if (!ptr)
+        return;
+    trackRemove(ptr);
+    releaseBlock(ptr);
+}
+
+void *reallocate(void *ptr, std::size_t size, const void *callSite)
+{
+    if (!callSite)
+        callSite = __builtin_return_address(0);
+    if (!ptr)
+        return allocate(size, Memory_CpuDefault, callSite);
+
+    void *newPtr = reallocateBlock(ptr, size);
+    if (!newPtr)
+        return NULL;
+    // Untracked before it is released, another task may get the address right away
+    trackRemove(ptr);
+    trackAdd(newPtr, size, callSite);
+    if (newPtr != ptr)
+        releaseBlock(ptr);
+    return newPtr;
+}
+
+std::size_t usableSize(const void *ptr)
+{
+    if (!ptr)
+        return 0;
+
+    vTaskSuspendAll();
+    SlabChunk *chunk = findChunk(ptr);
+    const int cls = chunk ? chunk->pageClass[(static_cast<const unsigned char *>(ptr) - chunk->base) / SLAB_PAGE_SIZE]
+                          : -1;
+    xTaskResumeAll();
+
+    if (cls >= 0)
+        return classSizes[cls];
+
+    LargeHeader *header = largeHeader(ptr);
+    return header ? header->capacity : 0;
+}
+
+void printStats()
+{
+    RegionStats regions[Region_Count];
+    ClassStats classes[ClassCount];
+    uint32_t pages;
+
+    vTaskSuspendAll();
+    memcpy(regions, regionStats, sizeof(regions));
+    memcpy(classes, classStats, sizeof(classes));
+    pages = slabPages;
+    xTaskResumeAll();
+
+    printf("heap: %-10s %10s %10s %8s\n", "region", "current", "peak", "blocks");
+    for (int i = 0; i < Region_Count; ++i) {
+        printf("heap: %-10s %10u %10u %8u\n",
+               regionNames[i],
+               (unsigned)regions[i].currentBytes,
+               (unsigned)regions[i].peakBytes,
+               (unsigned)regions[i].blocks);
+    }
+    printf("heap: hot pool free %u of %u bytes\n",
+           (unsigned)(SDRV_HOT_POOL_SIZE - hotPoolUsed),
+           (unsigned)SDRV_HOT_POOL_SIZE);
+
+    std::size_t slabUsed = 0;
+    printf("slab: %6s %8s %8s %10s\n", "class", "in use", "peak", "allocs");
+    for (int i = 0; i < ClassCount; ++i) {
+        if (!classes[i].allocations)
+            continue;
+        slabUsed += std::size_t(classes[i].inUse) * classSizes[i];
+        printf("slab: %6u %8u %8u %10u\n",
+               classSizes[i],
+               (unsigned)classes[i].inUse,
+               (unsigned)classes[i].peakInUse,
+               (unsigned)classes[i].allocations);
+    }
+    // Space in pages already handed to a size class but not in use
+    printf("slab: %u pages, %u bytes used, %u bytes free in pages\n",
+           (unsigned)pages,
+           (unsigned)slabUsed,
+           (unsigned)(std::size_t(pages) * SLAB_PAGE_SIZE - slabUsed));
+}
+
+} // namespace Allocator
+} // namespace Platform
+} // namespace Qul
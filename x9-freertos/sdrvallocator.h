@@ -0,0 +1,99 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVALLOCATOR_H
+#define SDRVALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Qul {
+namespace Platform {
+namespace Allocator {
+
+// Requests up to this size are served from size-class slabs
+#define SDRV_SLAB_MAX_SIZE 512
+
+// Blocks of at least this size keep 4 KB alignment for DC/G2D, smaller
+// large blocks are only cache line aligned
+#define SDRV_PAGE_ALIGN_MIN_SIZE 0x10000
+
+// Allocation tracking, enable with -DSDRV_MEM_TRACKING=1 (QUL_X9_MEM_TRACKING in CMake)
+#ifndef SDRV_MEM_TRACKING
+#define SDRV_MEM_TRACKING 0
+#endif
+
+// Live allocations the tracker can hold, must be a power of two
+#ifndef SDRV_MEM_TRACKING_SLOTS
+#define SDRV_MEM_TRACKING_SLOTS 4096
+#endif
+
+// Distinct call sites listed by printAllocationsSince()
+#ifndef SDRV_MEM_TRACKING_SITES
+#define SDRV_MEM_TRACKING_SITES 32
+#endif
+
+// Internal SRAM reserved for Memory_CpuHot slab chunks, a multiple of 64 KB
+// taken from .bss (QUL_X9_HOT_POOL_SIZE in CMake), 0 disables it. With a
+// pool, qul_malloc requests up to SDRV_SLAB_MAX_SIZE are Memory_CpuHot.
+#ifndef SDRV_HOT_POOL_SIZE
+#define SDRV_HOT_POOL_SIZE 0
+#endif
+
+enum MemoryType {
+    Memory_CpuDefault = 0,  /* Qul objects, slabs or SDK heap */
+    Memory_CpuHot,          /* small objects are kept in internal SRAM while the hot pool lasts, then as CpuDefault,
+                               they stay there when reallocated within the slab sizes */
+    Memory_Scanout,         /* read by DC: external DDR, 4 KB aligned, no dirty cache lines, NULL if not in DDR */
+    Memory_G2DScratch       /* read or written by G2D: external DDR, 4 KB aligned, no dirty cache lines, NULL if not in DDR */
+};
+
+// callSite tags the block in tracking mode, NULL means the caller of allocate()
+void *allocate(std::size_t size, MemoryType type = Memory_CpuDefault, const void *callSite = NULL);
+void release(void *ptr);
+
+// Resizes in place while the block capacity allows it, otherwise moves the
+// block and copies min(old size, size) bytes
+void *reallocate(void *ptr, std::size_t size, const void *callSite = NULL);
+
+// Usable size of a block returned by allocate(), 0 for NULL
+std::size_t usableSize(const void *ptr);
+
+// Current and peak bytes per region and size-class counters
+void printStats();
+
+#if SDRV_MEM_TRACKING
+// Marks a point in the allocation sequence. printAllocationsSince() lists
+// blocks allocated after the mark that are still live, grouped by call site,
+// e.g. around a page transition to find layers that were never released.
+uint32_t trackingMark();
+void printAllocationsSince(uint32_t mark);
+// Number of blocks allocated after the mark that are still live, bytes gets their size
+uint32_t liveAllocationsSince(uint32_t mark, std::size_t *bytes = NULL);
+#endif
+
+} // namespace Allocator
+
+// Prints heap and stack statistics every periodMs from a FreeRTOS timer
+void startMemoryStatsReport(uint32_t periodMs);
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVALLOCATOR_H
@@ -0,0 +1,133 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvassetpreload.h"
+#include "sdrvboot.h"
+#include "sdrvdma.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include <cstdio>
+#include <cstring>
+
+#if !defined(__ICCARM__)
+// From x9-platform.ld
+extern "C" unsigned char _keepinflash_assetdata_begin;
+extern "C" unsigned char _keepinflash_assetdata_end;
+#endif
+
+namespace Qul {
+namespace Platform {
+
+#define PRELOAD_TASK_STACK_SIZE 512
+
+struct PreloadRequest
+{
+    void *dst;
+    const void *src;
+    std::size_t size;
+};
+
+static PreloadRequest request;
+static SemaphoreHandle_t preloadDone = NULL;
+static bool preloaded = false;
+
+static void preloadTask(void *)
+{
+    if (!dmaCopy(request.dst, request.src, request.size))
+        memcpy(request.dst, request.src, request.size);
+    xSemaphoreGive(preloadDone);
+    vTaskDelete(NULL);
+}
+
+void startAssetPreload(void *dst, const void *src, std::size_t size)
+{
+    bootMark("asset preload start");
+    request.dst = dst;
+    request.src = src;
+    request.size = size;
+    if (size == 0)
+        return;
+
+    // Above the starting task, so that it submits the next chunk as soon as
+    // the DMA is done with the previous one. It sleeps in between.
+    const UBaseType_t priority = uxTaskPriorityGet(NULL) + 1;
+    preloadDone = xSemaphoreCreateBinary();
+    if (preloadDone
+        && xTaskCreate(preloadTask, "qul_preload", PRELOAD_TASK_STACK_SIZE, NULL, priority, NULL) == pdPASS)
+        return;
+
+    printf("asset preload task start failed, copying now\n");
+    if (preloadDone)
+        vSemaphoreDelete(preloadDone);
+    preloadDone = NULL;
+    if (!dmaCopy(dst, src, size))
+        memcpy(dst, src, size);
+}
+
+void waitForAssetPreload()
+{
+    if (preloaded)
+        return;
+    if (preloadDone) {
+        xSemaphoreTake(preloadDone, portMAX_DELAY);
+        vSemaphoreDelete(preloadDone);
+        preloadDone = NULL;
+    }
+    preloaded = true;
+    bootMark("asset preload done");
+}
+
+bool isKeepInFlashAsset(const void *data)
+{
+#if defined(__ICCARM__)
+#pragma section = "AssetDataKeepInFlash"
+    const unsigned char *begin = (const unsigned char *)__section_begin("AssetDataKeepInFlash");
+    const unsigned char *end = (const unsigned char *)__section_end("AssetDataKeepInFlash");
+#else
+    const unsigned char *begin = &_keepinflash_assetdata_begin;
+    const unsigned char *end = &_keepinflash_assetdata_end;
+#endif
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    return p >= begin && p < end;
+}
+
+std::size_t assetDataSize(const void *data, std::size_t maxSize)
+{
+#if defined(__ICCARM__)
+#pragma section = "AssetDataKeepInFlash"
+    const unsigned char *end = (const unsigned char *)__section_end("AssetDataKeepInFlash");
+#else
+    const unsigned char *end = &_keepinflash_assetdata_end;
+#endif
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    if (!isKeepInFlashAsset(data)) {
+        const unsigned char *preload = static_cast<const unsigned char *>(request.dst);
+        if (p < preload || p >= preload + request.size)
+            return maxSize;
+        end = preload + request.size;
+    }
+    return std::size_t(end - p) < maxSize ? std::size_t(end - p) : maxSize;
+}
+
+} // namespace Platform
+} // namespace Qul
@@ -0,0 +1,49 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVASSETPRELOAD_H
+#define SDRVASSETPRELOAD_H
+
+#include <cstddef>
+
+namespace Qul {
+namespace Platform {
+
+// Copies the AssetDataPreload segment from flash to RAM with DMA from a
+// background task, so that it overlaps with the rest of the startup.
+// Assets that should stay in flash are put into AssetDataKeepInFlash by Qul,
+// see CompilationOptions.cmake.
+void startAssetPreload(void *dst, const void *src, std::size_t size);
+
+// Blocks until the preload has finished, must be called before the first frame
+void waitForAssetPreload();
+
+// True for asset data that stays in QSPI flash (AssetDataKeepInFlash), which
+// is worth copying to RAM with dmaCopyAsync before it is blended repeatedly
+bool isKeepInFlashAsset(const void *data);
+
+// Bytes from data to the end of the asset segment holding it, at most
+// maxSize, which is also returned for data outside of the asset segments
+std::size_t assetDataSize(const void *data, std::size_t maxSize);
+
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVASSETPRELOAD_H
@@ -0,0 +1,110 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvboot.h"
+#include "sdrvclock.h"
+
+#include <cstdio>
+
+namespace Qul {
+namespace Platform {
+
+#define MAX_BOOT_MARKS     16
+#define MAX_DEFERRED_INITS 8
+
+struct BootMark
+{
+    const char *step;
+    uint64_t timeUs;
+};
+
+struct DeferredInit
+{
+    DeferredInitFunction function;
+    void *userData;
+};
+
+static BootMark marks[MAX_BOOT_MARKS];
+static int markCount = 0;
+static DeferredInit deferred[MAX_DEFERRED_INITS];
+static int deferredCount = 0;
+static bool firstFramePresented = false;
+static bool deferredDone = false;
+
+void bootMark(const char *step)
+{
+    if (deferredDone)
+        return;
+    // The compositor's post task marks the first frame next to the engine task
+    const int index = __atomic_fetch_add(&markCount, 1, __ATOMIC_RELAXED);
+    if (index >= MAX_BOOT_MARKS)
+        return;
+    marks[index].step = step;
+    marks[index].timeUs = clockUs();
+}
+
+void deferUntilFirstFrame(DeferredInitFunction function, void *userData)
+{
+    if (deferredDone || deferredCount == MAX_DEFERRED_INITS) {
+        function(userData);
+        return;
+    }
+    deferred[deferredCount].function = function;
+    deferred[deferredCount].userData = userData;
+    ++deferredCount;
+}
+
+void bootFramePresented()
+{
+    if (__atomic_load_n(&firstFramePresented, __ATOMIC_ACQUIRE))
+        return;
+    bootMark("first frame posted");
+    __atomic_store_n(&firstFramePresented, true, __ATOMIC_RELEASE);
+}
+
+static void printBootTimeline()
+{
+    const int count = markCount < MAX_BOOT_MARKS ? markCount : MAX_BOOT_MARKS;
+    printf("boot timeline (ms since reset)\n");
+    for (int i = 0; i < count; ++i) {
+        const uint64_t deltaUs = i ? marks[i].timeUs - marks[i - 1].timeUs : 0;
+        printf("  %8u.%03u  +%6u.%03u  %s\n",
+               (unsigned)(marks[i].timeUs / 1000),
+               (unsigned)(marks[i].timeUs % 1000),
+               (unsigned)(deltaUs / 1000),
+               (unsigned)(deltaUs % 1000),
+               marks[i].step);
+    }
+}
+
+void runDeferredInit()
+{
+    if (!__atomic_load_n(&firstFramePresented, __ATOMIC_ACQUIRE) || deferredDone)
+        return;
+
+    for (int i = 0; i < deferredCount; ++i)
+        deferred[i].function(deferred[i].userData);
+    bootMark("deferred init done");
+    deferredDone = true;
+    printBootTimeline();
+}
+
+} // namespace Platform
+} // namespace Qul
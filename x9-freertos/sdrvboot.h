@@ -0,0 +1,50 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVBOOT_H
+#define SDRVBOOT_H
+
+#include <cstdint>
+
+namespace Qul {
+namespace Platform {
+
+// Boot timeline: each mark records clockUs() (time since reset) with a step
+// name, the timeline is printed once the first frame has been posted.
+void bootMark(const char *step);
+
+// Work that is not needed for the first frame, e.g. asset preloading or
+// diagnostics, runs from the engine loop right after the first present.
+// Functions queued after that point run immediately.
+typedef void (*DeferredInitFunction)(void *userData);
+void deferUntilFirstFrame(DeferredInitFunction function, void *userData);
+
+// Called right after the first sdm_post of the primary screen, by presentFrame
+// of the framebuffer path and by the compositor for the layer engine, from
+// its post task or inline. bootMark and this are safe from any task.
+void bootFramePresented();
+
+// Called from the engine loop, runs the deferred work once the first frame is out
+void runDeferredInit();
+
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVBOOT_H
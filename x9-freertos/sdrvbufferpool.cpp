@@ -0,0 +1,137 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvbufferpool.h"
+#include "sdrvallocator.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace Qul {
+namespace Platform {
+
+static PlatformInterface::Rect united(const PlatformInterface::Rect &a, const PlatformInterface::Rect &b)
+{
+    if (a.isEmpty())
+        return b;
+    if (b.isEmpty())
+        return a;
+    const int left = std::min(a.x(), b.x());
+    const int top = std::min(a.y(), b.y());
+    const int right = std::max(a.x() + a.width(), b.x() + b.width());
+    const int bottom = std::max(a.y() + a.height(), b.y() + b.height());
+    return PlatformInterface::Rect(left, top, right - left, bottom - top);
+}
+
+SDRVBufferPool::SDRVBufferPool()
+    : m_count(0)
+    , m_front(0)
+    , m_drawSerial(0)
+{
+    for (int i = 0; i < SDRV_MAX_POOL_BUFFERS; ++i) {
+        m_buffers[i] = NULL;
+        m_usedInFrame[i] = 0;
+        m_drawnAt[i] = 0;
+    }
+}
+
+SDRVBufferPool::~SDRVBufferPool()
+{
+    release();
+}
+
+bool SDRVBufferPool::allocate(int count, const PlatformInterface::Size &size, int bytesPerLine)
+{
+    release();
+    m_count = std::min(std::max(count, 1), SDRV_MAX_POOL_BUFFERS);
+    m_size = size;
+    for (int i = 0; i < m_count; ++i) {
+        m_buffers[i] = (unsigned char *)Allocator::allocate(bytesPerLine * size.height(), Allocator::Memory_Scanout);
+        if (!m_buffers[i]) {
+            printf("SDRVBufferPool: allocating buffer %d of %d failed\n", i, m_count);
+            release();
+            return false;
+        }
+    }
+    return true;
+}
+
+void SDRVBufferPool::release()
+{
+    for (int i = 0; i < m_count; ++i) {
+        Allocator::release(m_buffers[i]);
+        m_buffers[i] = NULL;
+        m_usedInFrame[i] = 0;
+        m_drawnAt[i] = 0;
+    }
+    m_count = 0;
+    m_front = 0;
+    m_drawSerial = 0;
+}
+
+int SDRVBufferPool::acquire(uint32_t postedFrames) const
+{
+    if (m_count == 1)
+        return m_usedInFrame[0] <= postedFrames ? 0 : -1;
+
+    // Of the free buffers, the one drawn most recently has the least to catch up on
+    int best = -1;
+    for (int i = 0; i < m_count; ++i) {
+        if (i == m_front || (m_usedInFrame[i] != 0 && m_usedInFrame[i] >= postedFrames))
+            continue;
+        if (best < 0 || m_drawnAt[i] > m_drawnAt[best])
+            best = i;
+    }
+    return best;
+}
+
+void SDRVBufferPool::setFront(int index, const PlatformInterface::Rect &rect)
+{
+    ++m_drawSerial;
+    m_drawnRects[m_drawSerial % SDRV_MAX_POOL_BUFFERS] = rect;
+    m_drawnAt[index] = m_drawSerial;
+    m_front = index;
+}
+
+void SDRVBufferPool::markUsed(uint32_t frame)
+{
+    if (m_count)
+        m_usedInFrame[m_front] = frame;
+}
+
+bool SDRVBufferPool::staleRect(int index, PlatformInterface::Rect *rect) const
+{
+    if (index == m_front || m_drawSerial == 0)
+        return false;
+
+    if (m_drawnAt[index] == 0 || m_drawSerial - m_drawnAt[index] > SDRV_MAX_POOL_BUFFERS) {
+        *rect = PlatformInterface::Rect(0, 0, m_size.width(), m_size.height());
+        return true;
+    }
+
+    PlatformInterface::Rect stale;
+    for (uint32_t serial = m_drawnAt[index] + 1; serial <= m_drawSerial; ++serial)
+        stale = united(stale, m_drawnRects[serial % SDRV_MAX_POOL_BUFFERS]);
+    *rect = stale;
+    return !stale.isEmpty();
+}
+
+} // namespace Platform
+} // namespace Qul
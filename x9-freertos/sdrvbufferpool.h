@@ -0,0 +1,85 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVBUFFERPOOL_H
+#define SDRVBUFFERPOOL_H
+
+#include <platforminterface/rect.h>
+
+#include <cstdint>
+
+namespace Qul {
+namespace Platform {
+
+#define SDRV_MAX_POOL_BUFFERS 3
+
+/*
+ * Buffers of one layer, handed between the engine task drawing into them and
+ * the compositor and display reading them. Frames are numbered per screen by
+ * the compositor, starting at 1. A buffer that went into frame N is owned by
+ * the compositor and the display until frame N + 1 is posted, a single
+ * buffer is given back as soon as frame N is posted.
+ *
+ * Qul only redraws the dirty part of a layer, the pool also remembers what
+ * the last frames drew so that a reacquired buffer can be brought up to date.
+ */
+class SDRVBufferPool
+{
+public:
+    SDRVBufferPool();
+    ~SDRVBufferPool();
+
+    // Allocates count scanout buffers of the layer, false if out of memory
+    bool allocate(int count, const PlatformInterface::Size &size, int bytesPerLine);
+    void release();
+
+    int count() const { return m_count; }
+    unsigned char *buffer(int index) const { return m_buffers[index]; }
+    int front() const { return m_front; }
+
+    // A buffer the engine may draw into now, -1 while all of them are still owned
+    int acquire(uint32_t postedFrames) const;
+
+    // The buffer drawn at rect is now the one to show
+    void setFront(int index, const PlatformInterface::Rect &rect);
+
+    // The front buffer goes into frame
+    void markUsed(uint32_t frame);
+
+    // Part of the front buffer that buffer index lacks, false if it is up to date
+    bool staleRect(int index, PlatformInterface::Rect *rect) const;
+
+private:
+    int m_count;
+    int m_front;
+    unsigned char *m_buffers[SDRV_MAX_POOL_BUFFERS];
+    // Last frame each buffer went into, 0 for none
+    uint32_t m_usedInFrame[SDRV_MAX_POOL_BUFFERS];
+    // Draw serial each buffer was last drawn at, 0 for never
+    uint32_t m_drawnAt[SDRV_MAX_POOL_BUFFERS];
+    uint32_t m_drawSerial;
+    PlatformInterface::Size m_size;
+    PlatformInterface::Rect m_drawnRects[SDRV_MAX_POOL_BUFFERS];
+};
+
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVBUFFERPOOL_H
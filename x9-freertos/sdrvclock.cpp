@@ -0,0 +1,39 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvclock.h"
+
+#include "FreeRTOS.h"
+
+namespace Qul {
+namespace Platform {
+
+uint64_t clockUs()
+{
+    return vPortGetCurrentTimeUs();
+}
+
+uint64_t clockMs()
+{
+    return clockUs() / 1000;
+}
+
+} // namespace Platform
+} // namespace Qul
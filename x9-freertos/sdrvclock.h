@@ -0,0 +1,40 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVCLOCK_H
+#define SDRVCLOCK_H
+
+#include <cstdint>
+
+namespace Qul {
+namespace Platform {
+
+/*
+ * Monotonic 64-bit timebase, the run time stats counter of the port
+ * (vPortGetCurrentTimeUs), which never wraps during the lifetime of the
+ * device. Safe from both task and interrupt context.
+ */
+uint64_t clockUs();
+uint64_t clockMs();
+
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVCLOCK_H
@@ -0,0 +1,219 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvcompositor.h"
+#include "sdrvboot.h"
+#include "sdrvclock.h"
+#include "sdrvspscqueue.h"
+#include "sdrvwakeup.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <cstdio>
+
+namespace Qul {
+namespace Platform {
+namespace Compositor {
+
+#define POST_TASK_STACK_SIZE 1024
+#define POST_QUEUE_DEPTH 2
+// Posts anyway when the screen's vsync interrupt stays silent this long
+#define VSYNC_TIMEOUT_MS 100
+// Posts without any vsync on the screen before that is reported
+#define UNPACED_POSTS_WARNING 60
+
+struct ScreenCompositor
+{
+    int screen;
+    sdm::sdm_display_t *display;
+    TaskHandle_t task;
+    SDRVSpscQueue<ComposedFrame, POST_QUEUE_DEPTH> queue;
+    // Written by the engine task only
+    uint32_t submitted;
+    // Written by the post task, the engine task waits for them to catch up
+    volatile uint32_t composed;
+    volatile uint32_t posted;
+    uint32_t lastPostVsync;
+    uint32_t unpacedPosts;
+};
+
+static ScreenCompositor compositors[SDRV_MAX_SCREENS];
+
+static bool isValidScreen(int screen)
+{
+    return screen >= 0 && screen < SDRV_MAX_SCREENS;
+}
+
+static void post(ScreenCompositor &compositor, ComposedFrame &frame)
+{
+    struct sdm::sdm_post_config postData;
+    postData.bufs             = frame.bufs;
+    postData.n_bufs           = frame.bufCount;
+    postData.custom_data      = NULL;
+    postData.custom_data_size = 0;
+    sdm::sdm_post(compositor.display->handle, &postData);
+    if (compositor.screen == 0)
+        bootFramePresented();
+}
+
+/*waits until refreshInterval vsyncs have passed since the previous post*/
+static void waitForRefreshInterval(ScreenCompositor &compositor, int refreshInterval)
+{
+    // Without a vsync interrupt there is nothing to pace on
+    if (Screens::vsyncCount(compositor.screen) == 0) {
+        if (++compositor.unpacedPosts == UNPACED_POSTS_WARNING)
+            printf("compositor: no vsync interrupt on screen %d, its frames are not paced\n", compositor.screen);
+        return;
+    }
+
+    // Vsyncs only wake the task while it actually waits for one
+    Screens::notifyOnVsync(compositor.screen, true);
+    while (Screens::vsyncCount(compositor.screen) - compositor.lastPostVsync < uint32_t(refreshInterval)) {
+        if (!ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(VSYNC_TIMEOUT_MS)))
+            break;
+    }
+    Screens::notifyOnVsync(compositor.screen, false);
+}
+
+static void postTask(void *arg)
+{
+    ScreenCompositor &compositor = *static_cast<ScreenCompositor *>(arg);
+
+    ComposedFrame frame;
+    while (true) {
+        // Woken by submit, a vsync that came in late just loops around
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (compositor.queue.pop(frame)) {
+            // Compose right away, only the post waits for the vsync
+            const bool hasLayers = frame.compose ? frame.compose(frame, frame.composeData) : frame.bufCount > 0;
+            __atomic_add_fetch(&compositor.composed, 1, __ATOMIC_ACQ_REL);
+            signalEngineWakeup(Wakeup_Compositor);
+
+            if (hasLayers) {
+                waitForRefreshInterval(compositor, frame.refreshInterval);
+                post(compositor, frame);
+                compositor.lastPostVsync = Screens::vsyncCount(compositor.screen);
+            }
+            __atomic_add_fetch(&compositor.posted, 1, __ATOMIC_ACQ_REL);
+            signalEngineWakeup(Wakeup_Compositor);
+        }
+    }
+}
+
+bool start(int screen, sdm::sdm_display_t *display)
+{
+    if (!isValidScreen(screen) || !display)
+        return false;
+
+    ScreenCompositor &compositor = compositors[screen];
+    compositor.screen = screen;
+    compositor.display = display;
+    if (compositor.task)
+        return true;
+
+    // Above the engine task, so that a frame is posted as soon as its vsync comes
+    static const char *const names[SDRV_MAX_SCREENS] = {"qul_post0", "qul_post1"};
+    const UBaseType_t priority = uxTaskPriorityGet(NULL) + 1;
+    if (xTaskCreate(postTask, names[screen], POST_TASK_STACK_SIZE, &compositor, priority, &compositor.task) == pdPASS)
+        return true;
+
+    printf("compositor: post task for screen %d failed, posting inline\n", screen);
+    compositor.task = NULL;
+    return false;
+}
+
+void submit(int screen, const ComposedFrame &frame)
+{
+    if (!isValidScreen(screen))
+        return;
+
+    ScreenCompositor &compositor = compositors[screen];
+    ++compositor.submitted;
+    if (!compositor.task) {
+        ComposedFrame inlineFrame = frame;
+        if (inlineFrame.compose ? inlineFrame.compose(inlineFrame, inlineFrame.composeData) : inlineFrame.bufCount > 0)
+            post(compositor, inlineFrame);
+        compositor.composed = compositor.submitted;
+        compositor.posted = compositor.submitted;
+        return;
+    }
+
+    while (!compositor.queue.push(frame))
+        waitForEngineWakeup(Wakeup_Compositor, VSYNC_TIMEOUT_MS);
+    xTaskNotifyGive(compositor.task);
+}
+
+uint32_t nextFrame(int screen)
+{
+    return isValidScreen(screen) ? compositors[screen].submitted + 1 : 0;
+}
+
+uint32_t postedFrames(int screen)
+{
+    return isValidScreen(screen) ? __atomic_load_n(&compositors[screen].posted, __ATOMIC_ACQUIRE) : 0;
+}
+
+void waitUntilComposed(int screen)
+{
+    if (!isValidScreen(screen))
+        return;
+
+    ScreenCompositor &compositor = compositors[screen];
+    while (__atomic_load_n(&compositor.composed, __ATOMIC_ACQUIRE) != compositor.submitted)
+        waitForEngineWakeup(Wakeup_Compositor, VSYNC_TIMEOUT_MS);
+}
+
+void waitUntilPosted(int screen)
+{
+    if (!isValidScreen(screen))
+        return;
+
+    ScreenCompositor &compositor = compositors[screen];
+    while (__atomic_load_n(&compositor.posted, __ATOMIC_ACQUIRE) != compositor.submitted)
+        waitForEngineWakeup(Wakeup_Compositor, VSYNC_TIMEOUT_MS);
+}
+
+bool isPostTask(int screen)
+{
+    return isValidScreen(screen) && compositors[screen].task
+           && compositors[screen].task == xTaskGetCurrentTaskHandle();
+}
+
+uint64_t predictPresentUs(int screen, int refreshInterval)
+{
+    if (!isValidScreen(screen))
+        return 0;
+
+    uint64_t presentUs = Screens::predictNextVsyncUs(screen, clockUs());
+    const ScreenCompositor &compositor = compositors[screen];
+    if (!presentUs || !compositor.task)
+        return presentUs;
+
+    // Vsyncs the post still waits for, see waitForRefreshInterval
+    const int32_t waits = int32_t(compositor.lastPostVsync + refreshInterval - Screens::vsyncCount(screen));
+    for (int32_t i = 0; i < waits; ++i)
+        presentUs = Screens::predictNextVsyncUs(screen, presentUs);
+    return presentUs;
+}
+
+} // namespace Compositor
+} // namespace Platform
+} // namespace Qul
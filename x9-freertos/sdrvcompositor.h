@@ -0,0 +1,97 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVCOMPOSITOR_H
+#define SDRVCOMPOSITOR_H
+
+#include <lk_wrapper.h>
+namespace sdm {
+    #include "sdm_display.h"
+}
+
+#include "sdrvscreens.h"
+
+namespace Qul {
+namespace Platform {
+
+/*
+ * Every screen of the layer engine posts its frames from its own task, so
+ * that a screen waiting for its vsync does not hold up the engine task or
+ * the other screens. The engine task hands a frame over through a
+ * single-producer/single-consumer queue and carries on. The post task paces
+ * posts to the screen's own vsync and refresh interval.
+ *
+ * A frame is either composed already, or carries a compose function the
+ * post task runs first (SDRV_COMPOSE_PIPELINE). Then the G2D composition of
+ * frame N runs while the engine task renders frame N + 1.
+ */
+namespace Compositor {
+
+struct ComposedFrame;
+
+// Fills in the display layers of frame, false if there is nothing to post
+typedef bool (*ComposeFunction)(ComposedFrame &frame, void *composeData);
+
+// Display layers of one frame of a screen
+struct ComposedFrame
+{
+    struct sdm::sdm_buffer bufs[2];
+    int bufCount;
+    // Vsyncs between this and the previous post of the screen
+    int refreshInterval;
+    // NULL when bufs are composed already
+    ComposeFunction compose;
+    void *composeData;
+};
+
+// Starts the post task of the screen, without one frames are posted inline
+bool start(int screen, sdm::sdm_display_t *display);
+
+// Engine task: hand a frame over to the screen's post task. Frames are
+// numbered from 1, nextFrame is the number the next submitted frame gets.
+void submit(int screen, const ComposedFrame &frame);
+uint32_t nextFrame(int screen);
+
+// Frames of the screen that reached the display
+uint32_t postedFrames(int screen);
+
+// Engine task: block until all frames submitted for the screen are composed,
+// before changing state their compose functions read
+void waitUntilComposed(int screen);
+
+// Engine task: block until all frames submitted for the screen are posted,
+// before drawing into buffers the display may still be showing
+void waitUntilPosted(int screen);
+
+// True on the post task of the screen
+bool isPostTask(int screen);
+
+// When a frame of the screen composed now is first scanned out, on the
+// clockUs() timebase: the post task holds it back until refreshInterval
+// vsyncs have passed since the previous post, and the display takes it at
+// the vsync after sdm_post. 0 while the screen's vsync is not measured.
+// To be called from composition, on the post task or the engine task.
+uint64_t predictPresentUs(int screen, int refreshInterval);
+
+} // namespace Compositor
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVCOMPOSITOR_H
@@ -0,0 +1,222 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvdma.h"
+#include "sdrvwakeup.h"
+
+#include <config.h>
+#include <lk_wrapper.h>
+
+#if ENABLE_SD_DMA
+#include <dma_hal.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+
+namespace Qul {
+namespace Platform {
+
+#define CHUNKS_PER_TRANSFER (SDRV_DMA_MAX_ASYNC_SIZE / SDRV_DMA_CHUNK_SIZE)
+// A full async transfer takes a few milliseconds, report anything far beyond
+#define DMA_TIMEOUT_MS 100
+
+struct Transfer
+{
+    bool used;
+    volatile uint32_t remainingChunks;
+    volatile bool failed;
+    const unsigned char *srcBegin;
+    const unsigned char *srcEnd;
+    unsigned char *dstBegin;
+    unsigned char *dstEnd;
+#if ENABLE_SD_DMA
+    struct dma_desc *descs[CHUNKS_PER_TRANSFER];
+#endif
+    int descCount;
+};
+
+static Transfer transfers[SDRV_DMA_MAX_TRANSFERS];
+
+#if ENABLE_SD_DMA
+static struct dma_chan *memChannel = NULL;
+
+// DMA interrupt, the descriptors are freed by the engine task
+static void chunkDone(enum dma_status status, uint32_t, void *context)
+{
+    Transfer *transfer = static_cast<Transfer *>(context);
+    if (status != DMA_COMP)
+        transfer->failed = true;
+    if (__atomic_sub_fetch(&transfer->remainingChunks, 1, __ATOMIC_ACQ_REL) == 0)
+        signalEngineWakeupFromISR(Wakeup_Dma);
+}
+
+static bool dmaCopyChunk(unsigned char *dst, const unsigned char *src, std::size_t size)
+{
+    struct dma_desc *desc = hal_prep_dma_memcpy(memChannel, dst, (void *)src, size, DMA_INTERRUPT);
+    if (!desc)
+        return false;
+    hal_dma_submit(desc);
+    const enum dma_status status = hal_dma_sync_wait(desc, -1);
+    hal_dma_free_desc(desc);
+    return status == DMA_COMP;
+}
+#endif
+
+bool dmaCopy(void *dst, const void *src, std::size_t size)
+{
+    unsigned char *d = static_cast<unsigned char *>(dst);
+    const unsigned char *s = static_cast<const unsigned char *>(src);
+
+#if ENABLE_SD_DMA
+    if (!memChannel)
+        memChannel = hal_dma_chan_req(DMA_MEM);
+
+    if (memChannel) {
+        // Dirty lines must not be written back over the DMA data, and stale
+        // ones must not hide it from the CPU afterwards
+        arch_clean_invalidate_cache_range((addr_t)d, size);
+        for (std::size_t offset = 0; offset < size; offset += SDRV_DMA_CHUNK_SIZE) {
+            const std::size_t chunk = size - offset < SDRV_DMA_CHUNK_SIZE ? size - offset : SDRV_DMA_CHUNK_SIZE;
+            if (!dmaCopyChunk(d + offset, s + offset, chunk)) {
+                printf("dmaCopy: transfer of %u bytes at %p failed\n", (unsigned)chunk, d + offset);
+                return false;
+            }
+        }
+        arch_invalidate_cache_range((addr_t)d, size);
+        return true;
+    }
+    printf("dmaCopy: no DMA channel, using memcpy\n");
+#endif
+
+    memcpy(d, s, size);
+    return true;
+}
+
+static void finishTransfer(Transfer &transfer)
+{
+#if ENABLE_SD_DMA
+    for (int i = 0; i < transfer.descCount; ++i)
+        hal_dma_free_desc(transfer.descs[i]);
+    if (transfer.failed) {
+        printf("dmaCopyAsync: transfer to %p failed, copying with the CPU\n", transfer.dstBegin);
+        memcpy(transfer.dstBegin, transfer.srcBegin, transfer.dstEnd - transfer.dstBegin);
+        arch_clean_cache_range((addr_t)transfer.dstBegin, transfer.dstEnd - transfer.dstBegin);
+    } else {
+        arch_invalidate_cache_range((addr_t)transfer.dstBegin, transfer.dstEnd - transfer.dstBegin);
+    }
+#endif
+    transfer.used = false;
+}
+
+int dmaCopyAsync(void *dst, const void *src, std::size_t size)
+{
+#if ENABLE_SD_DMA
+    if (size == 0 || size > SDRV_DMA_MAX_ASYNC_SIZE)
+        return -1;
+    if (!memChannel)
+        memChannel = hal_dma_chan_req(DMA_MEM);
+    if (!memChannel)
+        return -1;
+
+    int id = 0;
+    while (id < SDRV_DMA_MAX_TRANSFERS && transfers[id].used)
+        ++id;
+    if (id == SDRV_DMA_MAX_TRANSFERS)
+        return -1;
+
+    Transfer &transfer = transfers[id];
+    unsigned char *d = static_cast<unsigned char *>(dst);
+    const unsigned char *s = static_cast<const unsigned char *>(src);
+    transfer.used = true;
+    transfer.failed = false;
+    transfer.srcBegin = s;
+    transfer.srcEnd = s + size;
+    transfer.dstBegin = d;
+    transfer.dstEnd = d + size;
+    transfer.descCount = 0;
+
+    arch_clean_invalidate_cache_range((addr_t)d, size);
+
+    // Prepare all descriptors first, so that the interrupt cannot see the
+    // count reach zero before the last chunk is submitted
+    for (std::size_t offset = 0; offset < size; offset += SDRV_DMA_CHUNK_SIZE) {
+        const std::size_t chunk = size - offset < SDRV_DMA_CHUNK_SIZE ? size - offset : SDRV_DMA_CHUNK_SIZE;
+        struct dma_desc *desc = hal_prep_dma_memcpy(memChannel, d + offset, (void *)(s + offset), chunk, DMA_INTERRUPT);
+        if (!desc) {
+            for (int i = 0; i < transfer.descCount; ++i)
+                hal_dma_free_desc(transfer.descs[i]);
+            transfer.used = false;
+            return -1;
+        }
+        desc->dmac_irq_evt_handle = chunkDone;
+        desc->context = &transfer;
+        transfer.descs[transfer.descCount++] = desc;
+    }
+
+    transfer.remainingChunks = transfer.descCount;
+    for (int i = 0; i < transfer.descCount; ++i)
+        hal_dma_submit(transfer.descs[i]);
+    return id;
+#else
+    return -1;
+#endif
+}
+
+bool dmaTransferDone(int id)
+{
+    Transfer &transfer = transfers[id];
+    if (!transfer.used)
+        return true;
+    if (__atomic_load_n(&transfer.remainingChunks, __ATOMIC_ACQUIRE) != 0)
+        return false;
+    finishTransfer(transfer);
+    return true;
+}
+
+void dmaWait(int id)
+{
+    // The controller may still write the destination, so a late transfer is
+    // reported but never abandoned
+    while (!dmaTransferDone(id)) {
+        if (!waitForEngineWakeup(Wakeup_Dma, DMA_TIMEOUT_MS) && !dmaTransferDone(id))
+            printf("dmaWait: transfer to %p still running after %d ms\n", transfers[id].dstBegin, DMA_TIMEOUT_MS);
+    }
+}
+
+static bool overlaps(const void *begin1, const void *end1, const void *begin2, const void *end2)
+{
+    return begin1 < end2 && begin2 < end1;
+}
+
+void dmaWaitForRange(const void *begin, const void *end)
+{
+    for (int id = 0; id < SDRV_DMA_MAX_TRANSFERS; ++id) {
+        const Transfer &transfer = transfers[id];
+        if (!transfer.used)
+            continue;
+        if (overlaps(begin, end, transfer.srcBegin, transfer.srcEnd)
+            || overlaps(begin, end, transfer.dstBegin, transfer.dstEnd))
+            dmaWait(id);
+    }
+}
+
+} // namespace Platform
+} // namespace Qul
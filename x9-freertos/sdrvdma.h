@@ -0,0 +1,57 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVDMA_H
+#define SDRVDMA_H
+
+#include <cstddef>
+
+namespace Qul {
+namespace Platform {
+
+// Largest block handed to the DMA controller in one descriptor
+#define SDRV_DMA_CHUNK_SIZE 0x40000
+
+// Memory to memory copy with the SoC DMA (ENABLE_SD_DMA) in chunks of
+// SDRV_DMA_CHUNK_SIZE, blocking the calling task but not the CPU. The
+// destination cache lines are invalidated. Falls back to memcpy when no DMA
+// channel is available. Returns false if a transfer failed.
+bool dmaCopy(void *dst, const void *src, std::size_t size);
+
+// Asynchronous copies of up to SDRV_DMA_MAX_ASYNC_SIZE, at most
+// SDRV_DMA_MAX_TRANSFERS in flight. Both the source and the destination range
+// count as busy until the transfer is waited for. Waiting is only allowed
+// from the engine task, it sleeps on the engine wakeup object.
+#define SDRV_DMA_MAX_TRANSFERS  8
+#define SDRV_DMA_MAX_ASYNC_SIZE (SDRV_DMA_CHUNK_SIZE * 32)
+
+// Returns a transfer id, or -1 if no transfer slot is free or size is too
+// large, the caller then copies synchronously
+int dmaCopyAsync(void *dst, const void *src, std::size_t size);
+bool dmaTransferDone(int id);
+void dmaWait(int id);
+
+// Waits for every transfer whose source or destination overlaps [begin, end)
+void dmaWaitForRange(const void *begin, const void *end);
+
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVDMA_H
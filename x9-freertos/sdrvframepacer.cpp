@@ -0,0 +1,155 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvframepacer.h"
+#include "sdrvscreens.h"
+
+#include <cstdio>
+
+namespace Qul {
+namespace Platform {
+
+SDRVFramePacer framePacer;
+
+static int popcount16(uint32_t bits)
+{
+    return __builtin_popcount(bits & 0xffff);
+}
+
+SDRVFramePacer::SDRVFramePacer()
+    : m_requestedInterval(1)
+    , m_adaptiveInterval(1)
+    , m_frameStartUs(0)
+    , m_excludedUs(0)
+    , m_lastPresentUs(0)
+    , m_frameCostUs(0)
+    , m_missHistory(0)
+    , m_fastFrames(0)
+{}
+
+bool SDRVFramePacer::hasVsync() const
+{
+    uint64_t lastVsyncUs;
+    uint32_t periodUs;
+    return Screens::vsyncTiming(0, &lastVsyncUs, &periodUs);
+}
+
+uint32_t SDRVFramePacer::refreshPeriodUs() const
+{
+    uint64_t lastVsyncUs;
+    uint32_t periodUs;
+    return Screens::vsyncTiming(0, &lastVsyncUs, &periodUs) ? periodUs : uint32_t(NominalPeriodUs);
+}
+
+void SDRVFramePacer::setRequestedInterval(int refreshInterval)
+{
+    m_requestedInterval = refreshInterval > 0 ? refreshInterval : 1;
+}
+
+int SDRVFramePacer::refreshInterval() const
+{
+    return m_requestedInterval > m_adaptiveInterval ? m_requestedInterval : m_adaptiveInterval;
+}
+
+void SDRVFramePacer::frameStarted(uint64_t timestampUs)
+{
+    m_frameStartUs = timestampUs;
+    m_excludedUs = 0;
+}
+
+void SDRVFramePacer::excludeWait(uint64_t waitUs)
+{
+    m_excludedUs += waitUs;
+}
+
+void SDRVFramePacer::framePresented(uint64_t timestampUs)
+{
+    m_lastPresentUs = timestampUs;
+}
+
+void SDRVFramePacer::frameRendered(uint64_t timestampUs)
+{
+    // Only the work of the frame, waiting for the display would make every
+    // frame look like it takes a full period
+    const uint64_t elapsed = timestampUs - m_frameStartUs;
+    const uint32_t cost = uint32_t(elapsed > m_excludedUs ? elapsed - m_excludedUs : 0);
+    m_frameCostUs = m_frameCostUs ? (m_frameCostUs * 7 + cost) / 8 : cost;
+
+    // A frame misses when it does not fit the interval it is paced at
+    const uint32_t periodUs = refreshPeriodUs();
+    const uint32_t budget = refreshInterval() * periodUs;
+    const bool missed = cost > budget - budget / 10;
+    m_missHistory = (m_missHistory << 1) | (missed ? 1 : 0);
+
+    if (m_adaptiveInterval == 1) {
+        if (popcount16(m_missHistory) >= MissThreshold) {
+            printf("frame pacing: missing budget, lowering to interval 2\n");
+            m_adaptiveInterval = 2;
+            m_missHistory = 0;
+            m_fastFrames = 0;
+        }
+    } else {
+        // Only go back once frames fit a single period with a clear margin
+        if (cost < periodUs * 6 / 10) {
+            if (++m_fastFrames >= RecoverFrames) {
+                printf("frame pacing: back to interval 1\n");
+                m_adaptiveInterval = 1;
+                m_missHistory = 0;
+            }
+        } else {
+            m_fastFrames = 0;
+        }
+    }
+}
+
+uint64_t SDRVFramePacer::predictNextVsyncUs(uint64_t nowUs)
+{
+    uint64_t lastVsyncUs;
+    uint32_t periodUs;
+    // Without a vsync interrupt, pace against the last present instead
+    if (!Screens::vsyncTiming(0, &lastVsyncUs, &periodUs)) {
+        lastVsyncUs = m_lastPresentUs;
+        periodUs = NominalPeriodUs;
+    }
+    if (lastVsyncUs > nowUs)
+        return lastVsyncUs;
+    return lastVsyncUs + ((nowUs - lastVsyncUs) / periodUs + 1) * periodUs;
+}
+
+uint64_t SDRVFramePacer::nextFrameStartUs(uint64_t nowUs)
+{
+    if (m_lastPresentUs == 0)
+        return nowUs;
+
+    // Earliest vsync the next frame may be shown at
+    const uint32_t periodUs = refreshPeriodUs();
+    uint64_t targetVsyncUs = predictNextVsyncUs(m_lastPresentUs) + (refreshInterval() - 1) * periodUs;
+    const uint32_t expectedCostUs = m_frameCostUs + m_frameCostUs / 4 + 500;
+
+    // Late already: aim at the next vsync we can still make
+    while (targetVsyncUs < nowUs + expectedCostUs && targetVsyncUs - m_lastPresentUs < 8ull * periodUs)
+        targetVsyncUs += periodUs;
+
+    const uint64_t startUs = targetVsyncUs > expectedCostUs ? targetVsyncUs - expectedCostUs : nowUs;
+    return startUs > nowUs ? startUs : nowUs;
+}
+
+} // namespace Platform
+} // namespace Qul
@@ -0,0 +1,84 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVFRAMEPACER_H
+#define SDRVFRAMEPACER_H
+
+#include <cstdint>
+
+namespace Qul {
+namespace Platform {
+
+/*
+ * Vsync-aligned frame pacing.
+ *
+ * The pacer takes the refresh timing of the first screen from Screens, as
+ * measured by its vsync interrupt, and predicts the upcoming vsyncs. Engine updates are started just early enough
+ * for the frame to be ready at the vsync it is meant for, honoring the
+ * refresh interval requested by Qul. When frames consistently miss their
+ * budget the pacer settles on a longer interval (30 Hz on a 60 Hz panel)
+ * instead of alternating between intervals, and only returns once frames fit
+ * the short interval comfortably again.
+ */
+class SDRVFramePacer
+{
+public:
+    SDRVFramePacer();
+
+    void setRequestedInterval(int refreshInterval);
+    void frameStarted(uint64_t timestampUs);
+    /* Time spent blocked on the display or a compositor, not frame cost */
+    void excludeWait(uint64_t waitUs);
+    /* Rendering is done, called before any vsync or back-pressure wait */
+    void frameRendered(uint64_t timestampUs);
+    void framePresented(uint64_t timestampUs);
+
+    /* Time at which the next engine update should start, never before nowUs */
+    uint64_t nextFrameStartUs(uint64_t nowUs);
+    uint64_t predictNextVsyncUs(uint64_t nowUs);
+
+    bool hasVsync() const;
+    int refreshInterval() const;
+    uint32_t refreshPeriodUs() const;
+
+private:
+    enum {
+        NominalPeriodUs = 16667, /* 60 Hz until measured */
+        MissWindow = 16,
+        MissThreshold = 4,
+        RecoverFrames = 120
+    };
+
+    int m_requestedInterval;
+    int m_adaptiveInterval;
+    uint64_t m_frameStartUs;
+    uint64_t m_excludedUs;
+    uint64_t m_lastPresentUs;
+    uint32_t m_frameCostUs;
+    uint32_t m_missHistory;
+    int m_fastFrames;
+};
+
+extern SDRVFramePacer framePacer;
+
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVFRAMEPACER_H
@@ -0,0 +1,150 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvg2dblit.h"
+
+#include <lk_wrapper.h>
+#include "disp_data_type.h"
+#include <g2dlite_api.h>
+
+#include "sdrvg2dlock.h"
+
+namespace Qul {
+namespace Platform {
+namespace G2DBlit {
+
+// More G2D jobs than this for one image cost more than blending it whole
+#define MAX_BLIT_SPANS 16
+
+struct SpanBlit
+{
+    void *g2d;
+    PlatformInterface::DrawingDevice *drawingDevice;
+    PlatformInterface::Point pos;
+    PlatformInterface::Rect sourceRect;
+    const unsigned char *sourceData;
+    int sourceFormat;
+    int sourceStride;
+    int targetFormat;
+    int opacity;
+    PlatformInterface::DrawingEngine::BlendMode blendMode;
+};
+
+int blendFormat(Qul::PixelFormat format)
+{
+    switch (format) {
+    case Qul::PixelFormat_ARGB32:
+    case Qul::PixelFormat_ARGB32_Premultiplied:
+        return COLOR_ARGB8888;
+    case Qul::PixelFormat_RGB32:
+        return COLOR_XRGB8888;
+    case Qul::PixelFormat_RGB16:
+        return COLOR_RGB565;
+    default:
+        return -1;
+    }
+}
+
+// Copies opaque spans, skips transparent ones and blends only the rest
+static void blitSpan(const PlatformInterface::Rect &span, OpaqueMap::Coverage coverage, void *userData)
+{
+    const SpanBlit &blit = *static_cast<const SpanBlit *>(userData);
+    const bool sourceOver = blit.blendMode == PlatformInterface::DrawingEngine::BlendMode_SourceOver;
+    if (sourceOver && (coverage == OpaqueMap::Coverage_Transparent || blit.opacity == 0))
+        return;
+    const bool copy = blit.opacity == 255 && (coverage == OpaqueMap::Coverage_Opaque || !sourceOver);
+
+    PlatformInterface::DrawingDevice *drawingDevice = blit.drawingDevice;
+    const int x = span.x();
+    const int y = span.y();
+    const int w = span.width();
+    const int h = span.height();
+    const int dstX = blit.pos.x() + x - blit.sourceRect.x();
+    const int dstY = blit.pos.y() + y - blit.sourceRect.y();
+
+    static struct g2dlite_input input;
+    input.layer_num = copy ? 1 : 2;
+    for (int i = 0; i < input.layer_num; i++) {
+        struct g2dlite_input_cfg *l = &input.layer[i];
+        const bool isSource = i == input.layer_num - 1;
+        l->layer_en = 1;
+        l->layer = i;
+        l->fmt = isSource ? blit.sourceFormat : blit.targetFormat;
+        l->zorder = i;
+        l->ckey.en = 0;
+        l->alpha = isSource ? blit.opacity : 255;
+
+        if (!isSource) {
+            l->blend = BLEND_PIXEL_NONE;
+            l->addr[0] = (unsigned long) (drawingDevice->bits());
+            l->src.x = dstX;
+            l->src.y = dstY;
+            l->src_stride[0] = drawingDevice->bytesPerLine();
+        } else {
+            l->blend = copy ? BLEND_PIXEL_NONE : BLEND_PIXEL_COVERAGE;
+            l->addr[0] = (unsigned long) (blit.sourceData);
+            l->src.x = x;
+            l->src.y = y;
+            l->src_stride[0] = blit.sourceStride;
+        }
+        l->src.w = w;
+        l->src.h = h;
+        l->dst.x = 0; // canvas: output x y
+        l->dst.y = 0;
+        l->dst.w = w;
+        l->dst.h = h;
+    }
+
+    input.output.width = w;
+    input.output.height = h;
+    input.output.fmt = blit.targetFormat;
+    input.output.addr[0] = (unsigned long) (drawingDevice->bits() + dstY * drawingDevice->bytesPerLine()
+                                            + dstX * (blit.targetFormat == COLOR_RGB565 ? 2 : 4));
+    input.output.stride[0] = drawingDevice->bytesPerLine();
+    input.output.rotation = 0;
+    G2DLocker g2dLocker;
+    hal_g2dlite_blend(blit.g2d, &input);
+}
+
+void blendImage(void *g2d,
+                PlatformInterface::DrawingDevice *drawingDevice,
+                const PlatformInterface::Point &pos,
+                const OpaqueMap::Source &source,
+                const PlatformInterface::Rect &sourceRect,
+                int opacity,
+                PlatformInterface::DrawingEngine::BlendMode blendMode)
+{
+    SpanBlit blit = {g2d,
+                     drawingDevice,
+                     pos,
+                     sourceRect,
+                     source.pixels,
+                     blendFormat(source.format),
+                     source.bytesPerLine,
+                     blendFormat(drawingDevice->format()),
+                     opacity < 255 ? opacity : 255,
+                     blendMode};
+    if (!OpaqueMap::forEachSpan(source, sourceRect, MAX_BLIT_SPANS, blitSpan, &blit))
+        blitSpan(sourceRect, OpaqueMap::Coverage_Mixed, &blit);
+}
+
+} // namespace G2DBlit
+} // namespace Platform
+} // namespace Qul
@@ -0,0 +1,56 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVG2DBLIT_H
+#define SDRVG2DBLIT_H
+
+#include <platforminterface/drawingdevice.h>
+#include <platforminterface/drawingengine.h>
+
+#include "sdrvopaquemap.h"
+
+namespace Qul {
+namespace Platform {
+namespace G2DBlit {
+
+// G2D blend layer and output format for a Qul pixel format, -1 if G2D cannot
+// read it. Shared by both drawing engines so that blits between different
+// formats agree on the channel order. Layer formats the DC scans out are a
+// separate mapping in the layer engine.
+int blendFormat(Qul::PixelFormat format);
+
+/*
+ * Blends sourceRect of source.pixels to pos on drawingDevice with G2D. Opaque
+ * spans are copied, transparent ones skipped for source-over and only the
+ * rest blended, see OpaqueMap. Both formats need a blendFormat.
+ */
+void blendImage(void *g2d,
+                PlatformInterface::DrawingDevice *drawingDevice,
+                const PlatformInterface::Point &pos,
+                const OpaqueMap::Source &source,
+                const PlatformInterface::Rect &sourceRect,
+                int opacity,
+                PlatformInterface::DrawingEngine::BlendMode blendMode);
+
+} // namespace G2DBlit
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVG2DBLIT_H
@@ -0,0 +1,74 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvg2dlock.h"
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+#include <config.h>
+#include <lk_wrapper.h>
+#include "disp_data_type.h"
+#include <g2dlite_api.h>
+
+#include <cstdio>
+
+namespace Qul {
+namespace Platform {
+
+#define RES_G2D_G2D2 0x4362200A
+
+static StaticSemaphore_t g2dMutexStorage;
+static SemaphoreHandle_t g2dMutex = NULL;
+static void *g2d = NULL;
+
+void initG2DLock()
+{
+    if (!g2dMutex)
+        g2dMutex = xSemaphoreCreateMutexStatic(&g2dMutexStorage);
+}
+
+void *g2dHandle()
+{
+    if (!g2d) {
+        if (!hal_g2dlite_creat_handle(&g2d, RES_G2D_G2D2)) {
+            printf("g2dlite creat handle failed\n");
+            g2d = NULL;
+            return NULL;
+        }
+        hal_g2dlite_init(g2d);
+    }
+    return g2d;
+}
+
+void lockG2D()
+{
+    if (g2dMutex)
+        xSemaphoreTake(g2dMutex, portMAX_DELAY);
+}
+
+void unlockG2D()
+{
+    if (g2dMutex)
+        xSemaphoreGive(g2dMutex);
+}
+
+} // namespace Platform
+} // namespace Qul
@@ -0,0 +1,48 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVG2DLOCK_H
+#define SDRVG2DLOCK_H
+
+namespace Qul {
+namespace Platform {
+
+// The drawing engines, the layer engine and the JPEG provider share one G2D
+// handle. With composition running on the compositor tasks
+// (SDRV_COMPOSE_PIPELINE) the engine task and those tasks take turns, each
+// submitted G2D job holds the lock. Until initG2DLock ran, locking does
+// nothing.
+void initG2DLock();
+
+// Creates and initializes the handle on first use, NULL if that failed
+void *g2dHandle();
+void lockG2D();
+void unlockG2D();
+
+struct G2DLocker
+{
+    G2DLocker() { lockG2D(); }
+    ~G2DLocker() { unlockG2D(); }
+};
+
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVG2DLOCK_H
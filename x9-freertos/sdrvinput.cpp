@@ -0,0 +1,245 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvinput.h"
+
+#include <cstring>
+
+#include "sdrvclock.h"
+#include "sdrvframepacer.h"
+#include "sdrvmpscqueue.h"
+#include "sdrvscreens.h"
+#include "sdrvtouch.h"
+#include "sdrvwakeup.h"
+
+#ifndef SDRV_INPUT_RING_SIZE
+#define SDRV_INPUT_RING_SIZE 64
+#endif
+
+namespace Qul {
+namespace Platform {
+namespace Input {
+
+enum EventType : uint8_t { Event_Touch, Event_Key, Event_Signal };
+
+#define SIGNAL_NO_COALESCE 0x1
+#define KEY_TEXT_SIZE 4
+
+struct Event
+{
+    EventType type;
+    bool flag; // touch pressed, key autorepeat, signal coalesced
+    uint16_t id; // touch screen, signal id
+    uint64_t timestampUs;
+    union {
+        struct
+        {
+            int32_t x;
+            int32_t y;
+        } touch;
+        struct
+        {
+            PlatformInterface::KeyEventType type;
+            int key;
+            unsigned int nativeScanCode;
+            unsigned int modifiers;
+            char text[KEY_TEXT_SIZE + 1];
+        } key;
+        int32_t value;
+    };
+};
+
+static SDRVMpscQueue<Event, SDRV_INPUT_RING_SIZE> ring;
+static Event batch[SDRV_INPUT_RING_SIZE];
+static uint32_t dropped = 0;
+
+// Touch state as delivered, a touch event that does not change it is a move
+static bool touchPressed[SDRV_MAX_SCREENS] = {false};
+static bool touchMoves[SDRV_INPUT_RING_SIZE];
+
+static SignalHandler signalHandler = NULL;
+static void *signalUserData = NULL;
+
+static bool post(Event &event)
+{
+    if (!ring.push(event)) {
+        __atomic_add_fetch(&dropped, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    signalEngineWakeup(Wakeup_Input);
+    return true;
+}
+
+bool postTouch(int screen, int x, int y, bool pressed, uint64_t timestampUs)
+{
+    if (screen < 0 || screen >= SDRV_MAX_SCREENS)
+        return false;
+
+    Event event;
+    event.type = Event_Touch;
+    event.flag = pressed;
+    event.id = uint16_t(screen);
+    event.touch.x = x;
+    event.touch.y = y;
+    event.timestampUs = timestampUs ? timestampUs : clockUs();
+    return post(event);
+}
+
+bool postKey(PlatformInterface::KeyEventType type,
+             int key,
+             unsigned int nativeScanCode,
+             unsigned int modifiers,
+             const char *text,
+             bool autorepeat)
+{
+    Event event;
+    event.type = Event_Key;
+    event.flag = autorepeat;
+    event.id = 0;
+    event.key.type = type;
+    event.key.key = key;
+    event.key.nativeScanCode = nativeScanCode;
+    event.key.modifiers = modifiers;
+    memset(event.key.text, 0, sizeof(event.key.text));
+    if (text)
+        strncpy(event.key.text, text, KEY_TEXT_SIZE);
+    event.timestampUs = clockUs();
+    return post(event);
+}
+
+bool postSignal(uint16_t id, int32_t value, bool coalesce)
+{
+    Event event;
+    event.type = Event_Signal;
+    event.flag = coalesce;
+    event.id = id;
+    event.value = value;
+    event.timestampUs = clockUs();
+    return post(event);
+}
+
+int postSignalMessage(const void *data, int length)
+{
+    const uint8_t *record = static_cast<const uint8_t *>(data);
+    int queued = 0;
+    for (; length >= 8; length -= 8, record += 8) {
+        const uint16_t id = uint16_t(record[0] | (record[1] << 8));
+        const uint16_t flags = uint16_t(record[2] | (record[3] << 8));
+        const uint32_t value = uint32_t(record[4]) | (uint32_t(record[5]) << 8) | (uint32_t(record[6]) << 16)
+                               | (uint32_t(record[7]) << 24);
+        if (postSignal(id, int32_t(value), !(flags & SIGNAL_NO_COALESCE)))
+            ++queued;
+    }
+    return queued;
+}
+
+void setSignalHandler(SignalHandler handler, void *userData)
+{
+    signalHandler = handler;
+    signalUserData = userData;
+}
+
+bool hasPendingEvents()
+{
+    return !ring.isEmpty();
+}
+
+uint32_t droppedEvents()
+{
+    return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+}
+
+/*a later event of the batch makes this one redundant*/
+static bool isSuperseded(int index, int count)
+{
+    const Event &event = batch[index];
+    if (event.type == Event_Key || (event.type == Event_Signal && !event.flag))
+        return false;
+    // Presses and releases always go through
+    if (event.type == Event_Touch && !touchMoves[index])
+        return false;
+
+    for (int i = index + 1; i < count; ++i) {
+        if (batch[i].type == event.type && batch[i].id == event.id)
+            return true;
+    }
+    return false;
+}
+
+static void deliver(const Event &event, uint64_t presentUs)
+{
+    const uint64_t timestamp = event.timestampUs / 1000;
+    switch (event.type) {
+    case Event_Touch:
+        Touch::dispatch(event.id, presentUs);
+        break;
+    case Event_Key:
+        PlatformInterface::handleKeyEvent(timestamp,
+                                          event.key.type,
+                                          event.key.key,
+                                          event.key.nativeScanCode,
+                                          event.key.modifiers,
+                                          event.key.text,
+                                          event.flag);
+        break;
+    case Event_Signal:
+        if (signalHandler)
+            signalHandler(event.id, event.value, timestamp, signalUserData);
+        break;
+    }
+}
+
+void deliverEvents()
+{
+    // At most one ring worth per engine update, so a burst cannot stall a frame
+    int count = 0;
+    while (count < SDRV_INPUT_RING_SIZE && ring.pop(batch[count]))
+        ++count;
+
+    for (int i = 0; i < count; ++i) {
+        if (batch[i].type != Event_Touch)
+            continue;
+        touchMoves[i] = batch[i].flag == touchPressed[batch[i].id];
+        touchPressed[batch[i].id] = batch[i].flag;
+    }
+
+    // Touch positions are predicted for the vsync this update is shown at on
+    // the touched screen. A screen without a vsync interrupt is shown when
+    // the engine presents, which the frame pacer predicts.
+    const uint64_t nowUs = clockUs();
+    uint64_t presentUs[SDRV_MAX_SCREENS];
+    for (int screen = 0; screen < SDRV_MAX_SCREENS; ++screen) {
+        presentUs[screen] = Screens::predictNextVsyncUs(screen, nowUs);
+        if (!presentUs[screen])
+            presentUs[screen] = framePacer.predictNextVsyncUs(nowUs);
+    }
+
+    for (int i = 0; i < count; ++i) {
+        // Coalesced touch samples still feed the motion estimate
+        if (batch[i].type == Event_Touch)
+            Touch::addSample(batch[i].id, batch[i].touch.x, batch[i].touch.y, batch[i].flag, batch[i].timestampUs);
+        if (!isSuperseded(i, count))
+            deliver(batch[i], presentUs[batch[i].type == Event_Touch ? batch[i].id : 0]);
+    }
+}
+
+} // namespace Input
+} // namespace Platform
+} // namespace Qul
@@ -0,0 +1,89 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVINPUT_H
+#define SDRVINPUT_H
+
+#include <platforminterface/platforminterface.h>
+
+#include <cstdint>
+
+namespace Qul {
+namespace Platform {
+namespace Input {
+
+/*
+ * Input from interrupt handlers and service tasks (touch controller, keys,
+ * vehicle signals received over RPMsg) goes through one bounded lock-free
+ * ring to the engine task. The post functions are safe from any task or
+ * interrupt context and return false when the ring is full, the event is
+ * then dropped and counted.
+ *
+ * The engine task delivers the events queued so far as one batch right
+ * before each engine update. Within a batch, a touch move is dropped when a
+ * later touch event of the same screen follows, and a coalesced signal is
+ * dropped when a later value of the same signal follows. Presses, releases
+ * and keys are always delivered, everything in posting order.
+ */
+
+// screen is the index into Screens::all(). timestampUs is when the
+// controller sampled the touch on the clockUs() timebase, 0 for now.
+//
+// Nothing in this tree reads a touch controller. The board integration
+// reports every sample of its touch driver, through Touch_InterruptHandler
+// in platform.cpp or by calling postTouch directly; there is no touch input
+// otherwise.
+bool postTouch(int screen, int x, int y, bool pressed, uint64_t timestampUs = 0);
+
+// text is UTF-8, at most 4 bytes are kept
+bool postKey(PlatformInterface::KeyEventType type,
+             int key,
+             unsigned int nativeScanCode,
+             unsigned int modifiers,
+             const char *text,
+             bool autorepeat);
+
+// With coalesce set, only the latest value per frame reaches the handler
+bool postSignal(uint16_t id, int32_t value, bool coalesce = true);
+
+/*
+ * Signal records as sent by the RPMsg service: packed little-endian
+ * {uint16 id, uint16 flags, int32 value}, flags bit 0 disables coalescing.
+ * To be called from the endpoint's receive callback, returns the number of
+ * records queued.
+ */
+int postSignalMessage(const void *data, int length);
+
+// Called on the engine task for every delivered signal, timestamp in ms
+typedef void (*SignalHandler)(uint16_t id, int32_t value, uint64_t timestamp, void *userData);
+void setSignalHandler(SignalHandler handler, void *userData);
+
+// Engine task only
+bool hasPendingEvents();
+void deliverEvents();
+
+// Events dropped because the ring was full
+uint32_t droppedEvents();
+
+} // namespace Input
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVINPUT_H
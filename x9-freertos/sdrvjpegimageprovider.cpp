@@ -0,0 +1,322 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvjpegimageprovider.h"
+#include "sdrvallocator.h"
+#include "sdrvg2dblit.h"
+#include "sdrvg2dlock.h"
+#include "sdrvsoftjpeg.h"
+
+#include <config.h>
+#include <lk_wrapper.h>
+#include "disp_data_type.h"
+#include <g2dlite_api.h>
+
+#if WITH_CHIPDEV_VPU_CODAJ12
+#include <jpuapi.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+
+namespace Qul {
+namespace Platform {
+
+#if WITH_CHIPDEV_VPU_CODAJ12
+
+// Bitstream buffer granularity and picture alignment for 4:2:0 MCUs
+#define JPU_STREAM_ALIGN 0x400
+#define JPU_MCU_ALIGN 16
+#define JPU_DECODE_TIMEOUT_MS 500
+
+static bool jpuInitialized = false;
+
+static inline int alignUp(int value, int align)
+{
+    return (value + align - 1) & ~(align - 1);
+}
+
+// Stops a decode that timed out, so that the JPU no longer touches its buffers
+static bool stopDecoder(JpgDecHandle handle)
+{
+    JPU_DecIssueStop(handle);
+    const int reason = JPU_WaitInterrupt(handle, JPU_DECODE_TIMEOUT_MS);
+    if (reason > 0) {
+        JPU_ClrStatus(handle, reason);
+        JPU_DecCompleteStop(handle);
+        return true;
+    }
+    printf("jpeg: JPU stop timed out, resetting it\n");
+    return JPU_HWReset() == JPG_RET_SUCCESS;
+}
+
+// Decodes to NV12, the JPU converts 4:2:2 and 4:4:4 sources on output
+static unsigned char *decodeToNv12(const unsigned char *data, std::size_t size, int *width, int *height, int *stride)
+{
+    // The JPU fetches the stream with its own DMA, flash is not reachable
+    const std::size_t streamSize = alignUp(size, JPU_STREAM_ALIGN);
+    unsigned char *stream = (unsigned char *)Allocator::allocate(streamSize, Allocator::Memory_G2DScratch);
+    if (!stream) {
+        printf("jpeg: no memory for %u byte stream\n", (unsigned)streamSize);
+        return NULL;
+    }
+    memcpy(stream, data, size);
+    memset(stream + size, 0, streamSize - size);
+    arch_clean_cache_range((addr_t)stream, streamSize);
+
+    JpgDecOpenParam openParam;
+    memset(&openParam, 0, sizeof(openParam));
+    openParam.bitstreamBuffer = (PhysicalAddress)stream;
+    openParam.bitstreamBufferSize = streamSize;
+    openParam.pBitStream = stream;
+    openParam.streamEndian = JDI_LITTLE_ENDIAN;
+    openParam.frameEndian = JDI_LITTLE_ENDIAN;
+    openParam.chromaInterleave = CBCR_INTERLEAVE;
+    openParam.packedFormat = PACKED_FORMAT_NONE;
+    openParam.outputFormat = FORMAT_420;
+
+    JpgDecHandle handle;
+    if (JPU_DecOpen(&handle, &openParam) != JPG_RET_SUCCESS) {
+        printf("jpeg: JPU_DecOpen failed\n");
+        Allocator::release(stream);
+        return NULL;
+    }
+
+    unsigned char *yuv = NULL;
+    JpgDecInitialInfo info;
+    // The whole stream is already in the buffer, an empty update marks its end
+    JPU_DecUpdateBitstreamBuffer(handle, size);
+    JPU_DecUpdateBitstreamBuffer(handle, 0);
+    if (JPU_DecGetInitialInfo(handle, &info) != JPG_RET_SUCCESS) {
+        printf("jpeg: not a supported JPEG stream\n");
+    } else {
+        const int lumaStride = alignUp(info.picWidth, JPU_MCU_ALIGN);
+        const int lumaSize = lumaStride * alignUp(info.picHeight, JPU_MCU_ALIGN);
+        yuv = (unsigned char *)Allocator::allocate(lumaSize + lumaSize / 2, Allocator::Memory_G2DScratch);
+
+        FrameBuffer frame;
+        memset(&frame, 0, sizeof(frame));
+        if (yuv) {
+            frame.bufY = (PhysicalAddress)yuv;
+            frame.bufCb = (PhysicalAddress)(yuv + lumaSize);
+            frame.stride = lumaStride;
+        }
+
+        JpgDecParam decParam;
+        memset(&decParam, 0, sizeof(decParam));
+        JpgDecOutputInfo outputInfo;
+        memset(&outputInfo, 0, sizeof(outputInfo));
+
+        bool decoded = false;
+        if (yuv && JPU_DecRegisterFrameBuffer(handle, &frame, 1, lumaStride) == JPG_RET_SUCCESS
+            && JPU_DecStartOneFrame(handle, &decParam) == JPG_RET_SUCCESS) {
+            const int reason = JPU_WaitInterrupt(handle, JPU_DECODE_TIMEOUT_MS);
+            if (reason > 0) {
+                JPU_ClrStatus(handle, reason);
+                decoded = JPU_DecGetOutputInfo(handle, &outputInfo) == JPG_RET_SUCCESS && outputInfo.decodingSuccess;
+            } else if (!stopDecoder(handle)) {
+                // The JPU may still fetch the stream and write the picture,
+                // leaking both is better than handing them to someone else
+                printf("jpeg: JPU did not stop, leaking %p and %p\n", stream, yuv);
+                JPU_DecClose(handle);
+                return NULL;
+            }
+        }
+
+        if (decoded) {
+            *width = info.picWidth;
+            *height = info.picHeight;
+            *stride = lumaStride;
+        } else {
+            printf("jpeg: decoding %dx%d failed\n", info.picWidth, info.picHeight);
+            Allocator::release(yuv);
+            yuv = NULL;
+        }
+    }
+
+    JPU_DecClose(handle);
+    Allocator::release(stream);
+    return yuv;
+}
+
+bool decodeJpeg(const unsigned char *data, std::size_t size, unsigned char **bits, int *width, int *height, int *bytesPerLine)
+{
+    if (!jpuInitialized) {
+        if (JPU_Init() != JPG_RET_SUCCESS) {
+            printf("jpeg: JPU_Init failed\n");
+            return false;
+        }
+        jpuInitialized = true;
+    }
+
+    int w, h, stride;
+    unsigned char *yuv = decodeToNv12(data, size, &w, &h, &stride);
+    if (!yuv)
+        return false;
+
+    unsigned char *argb = g2dHandle() ? (unsigned char *)Allocator::allocate(w * h * 4, Allocator::Memory_Scanout)
+                                      : NULL;
+    if (!argb) {
+        Allocator::release(yuv);
+        return false;
+    }
+
+    // G2D does the color conversion, the CPU never touches the pixels
+    static struct g2dlite_input input;
+    memset(&input, 0, sizeof(input));
+    input.layer_num = 1;
+
+    struct g2dlite_input_cfg *l = &input.layer[0];
+    l->layer_en = 1;
+    l->layer = 0;
+    l->fmt = COLOR_NV12;
+    l->zorder = 0;
+    l->alpha = 255;
+    l->blend = BLEND_PIXEL_NONE;
+    l->addr[0] = (unsigned long)yuv;
+    l->addr[1] = (unsigned long)(yuv + stride * alignUp(h, JPU_MCU_ALIGN));
+    l->src_stride[0] = stride;
+    l->src_stride[1] = stride;
+    l->src_x = 0;
+    l->src_y = 0;
+    l->src_w = w;
+    l->src_h = h;
+    l->dst_x = 0;
+    l->dst_y = 0;
+    l->dst_w = w;
+    l->dst_h = h;
+
+    input.output.width = w;
+    input.output.height = h;
+    // Same channel order the drawing engines blend the RGB32 image with
+    input.output.fmt = G2DBlit::blendFormat(Qul::PixelFormat_RGB32);
+    input.output.addr[0] = (unsigned long)argb;
+    input.output.stride[0] = w * 4;
+    input.output.rotation = 0;
+    {
+        G2DLocker g2dLocker;
+        hal_g2dlite_blend(g2dHandle(), &input);
+    }
+
+    Allocator::release(yuv);
+    *bits = argb;
+    *width = w;
+    *height = h;
+    *bytesPerLine = w * 4;
+    return true;
+}
+
+#else
+
+// Without the JPU, e.g. in host builds, the software decoder stands in
+bool decodeJpeg(const unsigned char *data, std::size_t size, unsigned char **bits, int *width, int *height, int *bytesPerLine)
+{
+    int w, h;
+    if (!SoftJpeg::readSize(data, size, &w, &h)) {
+        printf("jpeg: not a supported JPEG stream\n");
+        return false;
+    }
+
+    unsigned char *argb = (unsigned char *)Allocator::allocate(w * h * 4, Allocator::Memory_Scanout);
+    if (!argb)
+        return false;
+    if (!SoftJpeg::decode(data, size, argb, w * 4)) {
+        printf("jpeg: decoding %dx%d failed\n", w, h);
+        Allocator::release(argb);
+        return false;
+    }
+    // G2D and DC read the pixels from memory
+    arch_clean_cache_range((addr_t)argb, w * h * 4);
+
+    *bits = argb;
+    *width = w;
+    *height = h;
+    *bytesPerLine = w * 4;
+    return true;
+}
+
+#endif // WITH_CHIPDEV_VPU_CODAJ12
+
+static void releaseDecodedImage(void *bits)
+{
+    Allocator::release(bits);
+}
+
+SDRVJpegImageProvider::SDRVJpegImageProvider()
+    : mEntryCount(0)
+{}
+
+bool SDRVJpegImageProvider::addImage(const char *id, const unsigned char *data, std::size_t size)
+{
+    if (mEntryCount >= SDRV_JPEG_MAX_IMAGES) {
+        printf("jpeg: too many images, %s not added\n", id);
+        return false;
+    }
+
+    Entry &entry = mEntries[mEntryCount++];
+    entry.id = id;
+    entry.data = data;
+    entry.size = size;
+    entry.image = Qul::SharedImage();
+    entry.decoded = false;
+    return true;
+}
+
+void SDRVJpegImageProvider::clearCache()
+{
+    // Buffers still shown by an Image item are freed once it drops them
+    for (int i = 0; i < mEntryCount; ++i) {
+        mEntries[i].image = Qul::SharedImage();
+        mEntries[i].decoded = false;
+    }
+}
+
+Qul::SharedImage SDRVJpegImageProvider::requestImage(const char *imageId, std::size_t imageIdLength)
+{
+    for (int i = 0; i < mEntryCount; ++i) {
+        Entry &entry = mEntries[i];
+        if (strlen(entry.id) != imageIdLength || strncmp(entry.id, imageId, imageIdLength) != 0)
+            continue;
+
+        if (!entry.decoded) {
+            unsigned char *bits;
+            int width, height, bytesPerLine;
+            if (!decodeJpeg(entry.data, entry.size, &bits, &width, &height, &bytesPerLine))
+                return Qul::SharedImage();
+
+            entry.image = Qul::SharedImage(Qul::Image(bits,
+                                                      width,
+                                                      height,
+                                                      Qul::PixelFormat_RGB32,
+                                                      bytesPerLine,
+                                                      0,
+                                                      releaseDecodedImage,
+                                                      bits));
+            entry.decoded = true;
+        }
+        return entry.image;
+    }
+
+    printf("jpeg: unknown image %.*s\n", (int)imageIdLength, imageId);
+    return Qul::SharedImage();
+}
+
+} // namespace Platform
+} // namespace Qul
@@ -0,0 +1,82 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVJPEGIMAGEPROVIDER_H
+#define SDRVJPEGIMAGEPROVIDER_H
+
+#include <qul/imageprovider.h>
+
+#include <cstddef>
+
+#ifndef SDRV_JPEG_MAX_IMAGES
+#define SDRV_JPEG_MAX_IMAGES 16
+#endif
+
+namespace Qul {
+namespace Platform {
+
+/*
+ * Decodes a JPEG stream with the CODA J12 JPU and converts it to ARGB8888 with
+ * G2D, builds without the JPU use the software decoder in sdrvsoftjpeg. The
+ * result is a scanout capable buffer from Allocator::allocate, to be released
+ * with Allocator::release.
+ */
+bool decodeJpeg(const unsigned char *data, std::size_t size, unsigned char **bits, int *width, int *height, int *bytesPerLine);
+
+/*
+ * Image provider for JPEG assets. Images are decoded on first request and
+ * stay cached until clearCache(); the decoded buffer is used directly by
+ * G2D and by image layers, without another copy.
+ *
+ *   static SDRVJpegImageProvider jpegProvider;
+ *   jpegProvider.addImage("background", background_jpg, background_jpg_size);
+ *   app.addImageProvider("jpeg", &jpegProvider);
+ *
+ * and in QML: source: "image://jpeg/background"
+ */
+class SDRVJpegImageProvider : public Qul::ImageProvider
+{
+public:
+    SDRVJpegImageProvider();
+
+    // id and data must stay valid for the lifetime of the provider
+    bool addImage(const char *id, const unsigned char *data, std::size_t size);
+    void clearCache();
+
+    Qul::SharedImage requestImage(const char *imageId, std::size_t imageIdLength) override;
+
+private:
+    struct Entry
+    {
+        const char *id;
+        const unsigned char *data;
+        std::size_t size;
+        Qul::SharedImage image;
+        bool decoded;
+    };
+
+    Entry mEntries[SDRV_JPEG_MAX_IMAGES];
+    int mEntryCount;
+};
+
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVJPEGIMAGEPROVIDER_H
@@ -31,18 +31,44 @@
 #include <platform/mem.h>
 
 #include "sdrvlayerengine.h"
-
+#include "sdrvallocator.h"
+#include "sdrvbufferpool.h"
+#include "sdrvclock.h"
+#include "sdrvframepacer.h"
+#include "sdrvg2dblit.h"
+#include "sdrvg2dlock.h"
+#include "sdrvopaquemap.h"
+#include "sdrvprofiler.h"
+#include "sdrvrle.h"
+#include "sdrvscreenbuffer.h"
+#include "sdrvscreens.h"
+#include "sdrvtexturecache.h"
+#include "sdrvtilemask.h"
+#include "sdrvwakeup.h"
+
+#include <algorithm>
 #include <cstdio>
 
 namespace Qul {
 namespace Platform {
 
 #define PIXEL_GPU_LIMIT 1000
+// Root compose buffers are given back after this many frames without compose
+#define ROOT_COMPOSE_RELEASE_FRAMES 120
+// Composition of frame N overlaps drawing frame N + 1 and needs a third item layer buffer
+#if SDRV_COMPOSE_PIPELINE
+#define SDRV_ITEM_LAYER_BUFFERS 3
+#else
+#define SDRV_ITEM_LAYER_BUFFERS 1
+#endif
+// Waiting for the compositor wakes up at least this often
+#define COMPOSITOR_WAIT_MS 100
 
 extern volatile unsigned int currentFrame;
 ScreenLayerVecMap SDRVLayerEngine::mScreenRootLayerVecMap;
-unsigned char* SDRVLayerEngine::rootFrameBuffer[2] = {NULL, NULL};
-int SDRVLayerEngine::rootFrameBufferIndex = 0;
+ScreenStateMap SDRVLayerEngine::mScreenStateMap;
+LateLatchMap SDRVLayerEngine::mLateLatchMap;
+RetiredTextureVec SDRVLayerEngine::mRetiredTextures;
 static bool already_copy_source = false;
 
 static int toHwPixelFormat(Qul::PlatformInterface::LayerEngine::ColorDepth depth)
@@ -51,7 +77,7 @@ static int toHwPixelFormat(Qul::PlatformInterface::LayerEngine::ColorDepth depth
     case Qul::PlatformInterface::LayerEngine::Bpp32Alpha:
         return COLOR_ABGR8888;
     case Qul::PlatformInterface::LayerEngine::Bpp32:
-        return COLOR_RGB888;
+        return COLOR_XRGB8888;
     case Qul::PlatformInterface::LayerEngine::Bpp16:
         return COLOR_RGB565;
     default:
@@ -80,9 +106,12 @@ static int toHwPixelFormatFromPixelFormat(Qul::PixelFormat format)
     switch (format) {
         case Qul::PixelFormat_ARGB32:
         case Qul::PixelFormat_ARGB32_Premultiplied:
+        case Qul::PixelFormat_RLE_ARGB32:
+        case Qul::PixelFormat_RLE_ARGB32_Premultiplied:
             return COLOR_ABGR8888;
         case Qul::PixelFormat_RGB32:
-            return COLOR_RGB888;
+        case Qul::PixelFormat_RLE_RGB32:
+            return COLOR_XRGB8888;
         case Qul::PixelFormat_RGB16:
             return COLOR_RGB565;
         default:
@@ -91,12 +120,21 @@ static int toHwPixelFormatFromPixelFormat(Qul::PixelFormat format)
     }
 }
 
+/*formats G2D blends directly, others are drawn by the fallback engine*/
+static bool isHwBlendableFormat(Qul::PixelFormat format)
+{
+    return G2DBlit::blendFormat(format) >= 0;
+}
+
 static int bytesPerPixelFromPixelFormat(Qul::PixelFormat format)
 {
     switch (format) {
         case Qul::PixelFormat_ARGB32:
         case Qul::PixelFormat_ARGB32_Premultiplied:
         case Qul::PixelFormat_RGB32:
+        case Qul::PixelFormat_RLE_ARGB32:
+        case Qul::PixelFormat_RLE_ARGB32_Premultiplied:
+        case Qul::PixelFormat_RLE_RGB32:
             return FOUR_BIT;
         case Qul::PixelFormat_RGB16:
             return TWO_BIT;
@@ -126,11 +164,11 @@ static int bytesPerPixelFromHwPixelFormat(int hwFmt)
 {
     switch (hwFmt) {
     case COLOR_ABGR8888:
+    case COLOR_XRGB8888:
         return FOUR_BIT;
     case COLOR_RGB888:
         return THREE_BIT;
     case COLOR_RGB565:
-    case PixelFormat_RGB16:
         return TWO_BIT;
     default:
         printf("bytesPerPixelFromHwPixelFormat Unsupported pixel format %d\n", hwFmt);
@@ -150,6 +188,7 @@ SDRVHardwareLayer::SDRVHardwareLayer(const Qul::PlatformInterface::LayerEngine::
     , m_isRootLayer(pl ? false : true)
     , m_hwPixelFormat(hwPixelFormat)
     , m_zorder(p.z)
+    , m_opaque(hwPixelFormat != COLOR_ABGR8888 && hwPixelFormat != COLOR_ARGB8888)
 {
     //printf("SDRV SDRVLayerEngine SDRVHardwareLayer start %d,%d,%d,%d\n", hwPixelFormat, t, isRoot(), p.z);
     {
@@ -173,6 +212,7 @@ SDRVHardwareLayer::SDRVHardwareLayer(const Qul::PlatformInterface::LayerEngine::
 
     }
     updateProperties(p, s);
+    commit();
 }
 
 void SDRVHardwareLayer::updateProperties(const Qul::PlatformInterface::LayerEngine::LayerPropertiesBase &p,
@@ -254,7 +294,7 @@ void SDRVHardwareLayer::setG2dLayerProperties(const int src_x,
         
         // m_g2dLayer.blend = BLEND_PIXEL_NONE;
     // else
-    m_g2dLayer.blend = BLEND_PIXEL_COVERAGE;
+    m_g2dLayer.blend = (m_opaque && p.opacity > 0.99999f) ? BLEND_PIXEL_NONE : BLEND_PIXEL_COVERAGE;
 
     m_g2dLayer.src_stride[0] = s.width()*bytesPerPixelFromHwPixelFormat(m_g2dLayer.fmt);
 }
@@ -282,6 +322,53 @@ int SDRVHardwareLayer::setHwLayerBuffer(const unsigned char * buf, int stride)
     return DEFAULT_STATUS;
 }
 
+/*buffer composition put together for this frame, e.g. the one a sprite layer was composed into*/
+void SDRVHardwareLayer::setCommittedBuffer(const unsigned char *buf)
+{
+    m_committedDcLayer.addr[0] = (unsigned long) buf;
+    m_committedG2dLayer.addr[0] = (unsigned long) buf;
+}
+
+void SDRVHardwareLayer::setOpaque(bool opaque)
+{
+    m_opaque = opaque;
+    m_g2dLayer.blend = (m_opaque && m_props.opacity > 0.99999f) ? BLEND_PIXEL_NONE : BLEND_PIXEL_COVERAGE;
+}
+
+/*let the callback override position, opacity and buffer of this frame without an engine update*/
+void SDRVHardwareLayer::applyLateLatch(SDRVLateLatchCallback callback, void *userData, uint64_t presentUs)
+{
+    SDRVLateLatchState state;
+    state.presentUs = presentUs;
+    state.enabled = isRootLayer() ? m_committedDcLayer.layer_en : m_committedG2dLayer.layer_en;
+    state.x = isRootLayer() ? m_committedDcLayer.dst.x : m_committedG2dLayer.dst.x;
+    state.y = isRootLayer() ? m_committedDcLayer.dst.y : m_committedG2dLayer.dst.y;
+    /*the committed alpha, the properties may already belong to the next frame*/
+    state.opacity = m_committedG2dLayer.alpha / 255.0f;
+    state.buffer = (const unsigned char *)(isRootLayer() ? m_committedDcLayer.addr[0] : m_committedG2dLayer.addr[0]);
+    state.stride = isRootLayer() ? m_committedDcLayer.src_stride[0] : m_committedG2dLayer.src_stride[0];
+
+    if (!callback(state, userData))
+        return;
+
+    const int alpha = int(std::round(0xff * state.opacity));
+    m_committedDcLayer.layer_en = state.enabled;
+    m_committedDcLayer.dst.x = state.x;
+    m_committedDcLayer.dst.y = state.y;
+    m_committedDcLayer.alpha = alpha;
+    m_committedDcLayer.alpha_en = (state.opacity > 0.00001f && state.opacity < 0.99999f) ? 1 : 0;
+    m_committedDcLayer.addr[0] = (unsigned long) state.buffer;
+    m_committedDcLayer.src_stride[0] = state.stride;
+
+    m_committedG2dLayer.layer_en = state.enabled;
+    m_committedG2dLayer.dst.x = state.x;
+    m_committedG2dLayer.dst.y = state.y;
+    m_committedG2dLayer.alpha = alpha;
+    m_committedG2dLayer.blend = (m_opaque && state.opacity > 0.99999f) ? BLEND_PIXEL_NONE : BLEND_PIXEL_COVERAGE;
+    m_committedG2dLayer.addr[0] = (unsigned long) state.buffer;
+    m_committedG2dLayer.src_stride[0] = state.stride;
+}
+
 /*get buffer stride*/
 int SDRVHardwareLayer::getBufferStride()
 {
@@ -300,7 +387,8 @@ struct SDRVSpriteLayer : public Qul::PlatformInterface::LayerEngine::SpriteLayer
         // Allocate double buffers for hardware framebuffer layer
         int bufernum = doublebuf ? 2 : 1;
         for (int i = 0; i < bufernum; ++i)
-            framebuffers[i] = (unsigned char *)qul_malloc(p.size.width() * p.size.height() * bytesPerPixelFromColorDepth(p.colorDepth));
+            framebuffers[i] = (unsigned char *)Allocator::allocate(p.size.width() * p.size.height() * bytesPerPixelFromColorDepth(p.colorDepth),
+                                                                   Allocator::Memory_Scanout);
     }
 
     void updateProperties(const Qul::PlatformInterface::LayerEngine::SpriteLayerProperties &p)
@@ -320,10 +408,11 @@ struct SDRVSpriteLayer : public Qul::PlatformInterface::LayerEngine::SpriteLayer
         return doublebuf ? framebuffers[!frontBufferIndex] : framebuffers[0];
     }
 
+    /*composition side: the buffer just composed is the one to show*/
     void swap()
     {
         //first set hw buffer
-        setHwLayerBuffer(getNextDrawBuffer());
+        setCommittedBuffer(getNextDrawBuffer());
         //second swap buffer
         if (doublebuf)
             frontBufferIndex = !frontBufferIndex;
@@ -367,21 +456,22 @@ struct SDRVSpriteLayer : public Qul::PlatformInterface::LayerEngine::SpriteLayer
     int bltChildLayer()
     {
         //printf("SDRV bltChildLayer child num = %d\n", getChildNum());
-        if ( getChildNum() <= 0)  
+        if (mCommittedChildren.empty())
             return DEFAULT_STATUS;
 
+        G2DLocker g2dLocker;
         struct g2dlite_input input;
         memset(&input, 0, sizeof(g2dlite_input));
-        std::map<int, SDRVHardwareLayer *>::iterator it;
-        it=mSpriteChildMap.begin();
-        input.layer[input.layer_num] = (it->second)->getG2dInputConfig();
+        std::vector<g2dlite_input_cfg>::iterator it;
+        it=mCommittedChildren.begin();
+        input.layer[input.layer_num] = *it;
         input.layer[input.layer_num].zorder = 0;
         input.layer[input.layer_num].layer = 0;
         input.layer_num++;
 
-        for (++it; it != mSpriteChildMap.end(); ++it) {
+        for (++it; it != mCommittedChildren.end(); ++it) {
             if (input.layer_num < 2) {
-                input.layer[input.layer_num] = (it->second)->getG2dInputConfig();
+                input.layer[input.layer_num] = *it;
                 input.layer[input.layer_num].zorder = 1;
                 input.layer[input.layer_num].layer = 1;
                 input.layer_num++;
@@ -405,7 +495,7 @@ struct SDRVSpriteLayer : public Qul::PlatformInterface::LayerEngine::SpriteLayer
 
             //for second g2d blend
             memset(&input, 0, sizeof(g2dlite_input));
-            input.layer[input.layer_num] = getG2dInputConfig();//sprite layer g2dconfig
+            input.layer[input.layer_num] = getCommittedG2dInputConfig();//sprite layer g2dconfig
             input.layer[input.layer_num].addr[0] = (unsigned long)(getNextDrawBuffer());
             input.layer[input.layer_num].zorder = 0;
             input.layer[input.layer_num].layer = 0;
@@ -419,6 +509,9 @@ struct SDRVSpriteLayer : public Qul::PlatformInterface::LayerEngine::SpriteLayer
     unsigned char *framebuffers[2];
 
     SpriteChildMap mSpriteChildMap;
+    /*children and their g2d configs by z-order, see SDRVLayerEngine::commitFrame*/
+    std::vector<SDRVHardwareLayer *> mCommittedChildLayers;
+    std::vector<g2dlite_input_cfg> mCommittedChildren;
 };
 
 void SDRVDrawingEngine::blendImage(Qul::PlatformInterface::DrawingDevice *drawingDevice, 
@@ -428,6 +521,7 @@ void SDRVDrawingEngine::blendImage(Qul::PlatformInterface::DrawingDevice *drawin
                     int sourceOpacity, 
                     Qul::PlatformInterface::DrawingEngine::BlendMode blendMode)
 {
+    SDRV_PROFILE_SCOPE(Phase_BlendImage);
     // printf("blendImage----------------dsadsdsds------------------------------------------\r\n");
     // if(sourceRect.width() * sourceRect.height() < PIXEL_GPU_LIMIT) {
         // drawingDevice->fallbackDrawingEngine()->blendImage(drawingDevice, pos, source, sourceRect, sourceOpacity, blendMode);
@@ -435,63 +529,32 @@ void SDRVDrawingEngine::blendImage(Qul::PlatformInterface::DrawingDevice *drawin
         // return;
     // }
     
-    int x = sourceRect.x();
-    int y = sourceRect.y();
-    int w =  sourceRect.width();
-    int h =  sourceRect.height();
-    // fallbackDrawingEngine()->blendImage(drawingDevice, pos, source, sourceRect, sourceOpacity, blendMode);
-
-    static struct g2dlite_input input;
-    input.layer_num = 2;
-    // printf("g2dlite_input----------------------------------------------------------\r\n");
-    for (int i = 0; i < input.layer_num; i++) {
-        struct g2dlite_input_cfg  *l = &input.layer[i];
-        l->layer_en = 1;
-        l->layer = i;
-        l->fmt = COLOR_ARGB8888;
-        l->zorder = i;
-        l->ckey.en = 0;
-
-        l->alpha = 255;
-
-        if (i == 0) {
-            l->blend = BLEND_PIXEL_NONE;
-            l->addr[0] = (unsigned long) (drawingDevice->bits());
-            l->src.x = pos.x();
-            l->src.y = pos.y();
-            l->src.w = w;
-            l->src.h = h;
-            l->src_stride[0] = drawingDevice->width()*4;
-
-            l->dst.x = 0;// canvas :output x y
-            l->dst.y = 0;
-            l->dst.w = w;
-            l->dst.h = h;
+    /*RLE textures are decoded into the texture cache, G2D cannot read them*/
+    const unsigned char *sourceData = NULL;
+    int sourceStride = source.bytesPerLine();
+    TextureCache::Decoder decoder = rleDecoder(source.format());
+    const Qul::PixelFormat sourceFormat = decoder ? rleDecodedFormat(source.format()) : source.format();
+    if (isHwBlendableFormat(sourceFormat) && isHwBlendableFormat(drawingDevice->format())) {
+        if (decoder) {
+            sourceStride = source.width() * 4;
+            const std::size_t size = sourceStride * source.height();
+            sourceData = TextureCache::lookup(source.data(), size, decoder, rleDataSize(source.data(), size));
         } else {
-            l->blend = BLEND_PIXEL_COVERAGE;
-            l->addr[0] = (unsigned long) (source.data());
-            l->src.x = x;
-            l->src.y = y;
-            l->src.w = w;
-            l->src.h = h;
-            l->src_stride[0] = source.width()*4;
-
-            l->dst.x = 0;// canvas :output x y
-            l->dst.y = 0;
-            l->dst.w = w;
-            l->dst.h = h;
+            sourceData = TextureCache::lookup(source.data(), sourceStride * source.height());
         }
     }
-    
-    input.output.width = w;
-    input.output.height = h;
-    input.output.fmt = COLOR_ARGB8888;
-    input.output.addr[0] = (unsigned long)(drawingDevice->bits() + pos.y()*drawingDevice->width()*4 + pos.x()*4);
-    //input.output.addr[0] = (unsigned long)(drawingDevice->bits());
-    input.output.stride[0] = drawingDevice->width()*4;
-    input.output.rotation = 0;
-    hal_g2dlite_blend(G2D, &input);
-    
+    if (!sourceData) {
+        fallbackDrawingEngine()->blendImage(drawingDevice, pos, source, sourceRect, sourceOpacity, blendMode);
+        return;
+    }
+
+    const OpaqueMap::Source opaqueSource = {source.data(),
+                                            sourceData,
+                                            sourceFormat,
+                                            source.width(),
+                                            source.height(),
+                                            sourceStride};
+    G2DBlit::blendImage(G2D, drawingDevice, pos, opaqueSource, sourceRect, sourceOpacity, blendMode);
 }
 
 static uint32_t argb8888_to_rgb2101010(Qul::PlatformInterface::Rgba32 color)
@@ -504,6 +567,7 @@ void SDRVDrawingEngine::blendRect(Qul::PlatformInterface::DrawingDevice * drawin
                                   Qul::PlatformInterface::Rgba32 color , 
                                   Qul::PlatformInterface::DrawingEngine::BlendMode blendMode)
 {
+    SDRV_PROFILE_SCOPE(Phase_BlendRect);
     // printf("blendRect----------------------333---------------\r\n");
     // printf("rect x = %d,rect y = %d,rect width = %d,rect height = %d----color.alpha() = %d----color.value = %u   --blendMode = %d----drawingDevice->width() = %d-drawingDevice->height() = %d-drawingDevice.format = %d-\r\n",rect.x(),rect.y(),rect.width(),rect.height(),color.alpha(),color.value,blendMode,drawingDevice->width(),drawingDevice->height(),drawingDevice->format());
     
@@ -513,43 +577,64 @@ void SDRVDrawingEngine::blendRect(Qul::PlatformInterface::DrawingDevice * drawin
     //     printf("fallback----------------fallback--------------------fallback-----------------fallback---DrawingEngine!!!!!!!!!!!!!--\r\n");
         // return;
     // }
-    int rgb_to_bit = bytesPerPixelFromHwPixelFormat(drawingDevice->format());
-    if(!rgb_to_bit)
+    if (!isHwBlendableFormat(drawingDevice->format())) {
+        fallbackDrawingEngine()->blendRect(drawingDevice, rect, color, blendMode);
         return;
+    }
+    int rgb_to_bit = bytesPerPixelFromPixelFormat(drawingDevice->format());
 
     struct g2dlite_output_cfg output;
     output.width = rect.width();
     output.height = rect.height();
     output.o_x = rect.x();
     output.o_y = rect.y();
-    output.fmt = COLOR_RGB565;
-    output.addr[0] = (unsigned long)(drawingDevice->bits() + rect.y() * drawingDevice->width() * rgb_to_bit + rect.x() * rgb_to_bit);
-    output.stride[0] = drawingDevice->width() * rgb_to_bit;
+    output.fmt = G2DBlit::blendFormat(drawingDevice->format());
+    output.addr[0] = (unsigned long)(drawingDevice->bits() + rect.y() * drawingDevice->bytesPerLine() + rect.x() * rgb_to_bit);
+    output.stride[0] = drawingDevice->bytesPerLine();
     output.rotation = 0;
 
+    G2DLocker g2dLocker;
     hal_g2dlite_fill_rect(G2D, argb8888_to_rgb2101010(color), color.alpha(), 0, 0, 0, &output);
 
 }
 
+/*item layer drawing device, remembers the tiles the cpu fallbacks write*/
+struct SDRVItemDrawingDevice : public Qul::PlatformInterface::DrawingDevice
+{
+    SDRVItemDrawingDevice(Qul::PixelFormat format, const Qul::PlatformInterface::Size &size, int bytesPerLine)
+        : Qul::PlatformInterface::DrawingDevice(format, size, nullptr, bytesPerLine, &sdrvDrawingEngine)
+    {
+        cpuTiles.reset(size.width(), size.height());
+    }
+
+    SDRVTileMask cpuTiles;
+};
+
 void SDRVDrawingEngine::synchronizeForCpuAccess(Qul::PlatformInterface::DrawingDevice * drawingDevice , 
                                                 const Qul::PlatformInterface::Rect & rect)
 {
     // arch_clean_cache_range((addr_t), pixel size;
+#if SDRV_TILED_FRAMEBUFFER
+    /*sdrvDrawingEngine only draws into item layers*/
+    static_cast<SDRVItemDrawingDevice *>(drawingDevice)->cpuTiles.markRect(rect);
+#endif
 }
 
 struct SDRVItemLayer : public Qul::PlatformInterface::LayerEngine::ItemLayer, public SDRVHardwareLayer
 {
     SDRVItemLayer(const Qul::PlatformInterface::LayerEngine::ItemLayerProperties &p, SDRVSpriteLayer * spritelayer)
         : SDRVHardwareLayer(p, p.size, toHwPixelFormat(p.colorDepth), SDRVLayerType::SDRV_ITEM_LAYER, spritelayer),
-                            drawingDevice(toPixelFormat(p.colorDepth), p.size, nullptr,
-                            p.size.width() * bytesPerPixelFromColorDepth(p.colorDepth),
-                            &sdrvDrawingEngine)
+                            drawingDevice(toPixelFormat(p.colorDepth), p.size,
+                            p.size.width() * bytesPerPixelFromColorDepth(p.colorDepth))
     {
-        // Allocate double buffers for hardware framebuffer layer
-        int bufernum = doublebuf ? 2 : 1;
+        // One buffer drawn in place, or a pool the compositor works from while the next frame is drawn
         framebufferSize = p.size.width() * p.size.height() * bytesPerPixelFromColorDepth(p.colorDepth);
-        for (int i = 0; i < bufernum; ++i)
-            framebuffers[i] = (unsigned char *)qul_malloc(framebufferSize);
+        const int bytesPerLine = p.size.width() * bytesPerPixelFromColorDepth(p.colorDepth);
+        /*a single buffer still works, the compositor then finishes each frame before the next is drawn*/
+        if (!pool.allocate(SDRV_ITEM_LAYER_BUFFERS, p.size, bytesPerLine) && SDRV_ITEM_LAYER_BUFFERS > 1)
+            pool.allocate(1, p.size, bytesPerLine);
+        if (pool.count())
+            setHwLayerBuffer(pool.buffer(0));
     }
 
     void updateProperties(const Qul::PlatformInterface::LayerEngine::ItemLayerProperties &p)
@@ -557,16 +642,9 @@ struct SDRVItemLayer : public Qul::PlatformInterface::LayerEngine::ItemLayer, pu
         SDRVHardwareLayer::updateProperties(p, p.size);
     }
 
-    ~SDRVItemLayer()
-    {
-        int bufernum = doublebuf ? 2 : 1;
-        for (int i = 0; i < bufernum; ++i)
-            qul_free(framebuffers[i]);
-    }
-
     unsigned char *getNextDrawBuffer()
     {
-        return doublebuf ? framebuffers[!frontBufferIndex] : framebuffers[0];
+        return pool.buffer(drawIndex);
     }
     int getFrameBufferSize()
     {
@@ -577,14 +655,46 @@ struct SDRVItemLayer : public Qul::PlatformInterface::LayerEngine::ItemLayer, pu
         //first set hw buffer
         setHwLayerBuffer(getNextDrawBuffer());
         //second swap buffer
-        if (doublebuf)
-            frontBufferIndex = !frontBufferIndex;
+        pool.setFront(drawIndex, drawRect);
     }
-    bool doublebuf = false;
-    int frontBufferIndex = 0;
+    /*bring the draw buffer up to date with the front buffer where later frames drew*/
+    void copyForward()
+    {
+        Qul::PlatformInterface::Rect rect;
+        if (drawIndex == pool.front() || !pool.staleRect(drawIndex, &rect))
+            return;
+
+        const int stride = drawingDevice.bytesPerLine();
+        const int offset = rect.y() * stride + rect.x() * bytesPerPixelFromPixelFormat(drawingDevice.format());
+        struct g2dlite_input input;
+        memset(&input, 0, sizeof(g2dlite_input));
+        input.layer_num = 1;
+        struct g2dlite_input_cfg *l = &input.layer[0];
+        l->layer_en = 1;
+        l->fmt = getHwFmt();
+        l->alpha = 255;
+        l->blend = BLEND_PIXEL_NONE;
+        l->addr[0] = (unsigned long)(pool.buffer(pool.front()) + offset);
+        l->src.w = rect.width();
+        l->src.h = rect.height();
+        l->src_stride[0] = stride;
+        l->dst.w = rect.width();
+        l->dst.h = rect.height();
+
+        input.output.width = rect.width();
+        input.output.height = rect.height();
+        input.output.fmt = getHwFmt();
+        input.output.addr[0] = (unsigned long)(pool.buffer(drawIndex) + offset);
+        input.output.stride[0] = stride;
+        input.output.rotation = 0;
+        G2DLocker g2dLocker;
+        hal_g2dlite_blend(G2D, &input);
+    }
+    int drawIndex = 0;
+    Qul::PlatformInterface::Rect drawRect;
     int framebufferSize  = 0;
-    unsigned char *framebuffers[2];
-    Qul::PlatformInterface::DrawingDevice drawingDevice;
+    SDRVBufferPool pool;
+    SDRVItemDrawingDevice drawingDevice;
 };
 
 struct SDRVImageLayer : public Qul::PlatformInterface::LayerEngine::ImageLayer, public SDRVHardwareLayer
@@ -601,100 +711,247 @@ struct SDRVImageLayer : public Qul::PlatformInterface::LayerEngine::ImageLayer,
         // memcpy(framebuffers, p.texture.data(), p.texture.size().width() * p.texture.size().height() * bytesPerPixelFromPixelFormat(p.texture.format()));
         // arch_clean_cache_range((addr_t)framebuffers, p.texture.size().width()*p.texture.size().height()*bytesPerPixelFromPixelFormat(p.texture.format()));
         // setHwLayerBuffer(framebuffers, p.texture.size().width()*bytesPerPixelFromPixelFormat(p.texture.format()));
-        setHwLayerBuffer(p.texture.data(), p.texture.size().width()*bytesPerPixelFromPixelFormat(p.texture.format()));
+        setTexture(p.texture);
     }
 
     void updateProperties(const Qul::PlatformInterface::LayerEngine::ImageLayerProperties &p)
     {
         SDRVHardwareLayer::updateProperties(p, p.texture.size());
+        if (p.texture.data() != texture)
+            setTexture(p.texture);
+        else
+            applyBuffer();
     }
 
+    /*deallocateImageLayer retires the texture, only a layer that never got shown still holds it*/
     ~SDRVImageLayer()
     {
-        qul_free(framebuffers);
+        TextureCache::unpin(texture);
+    }
+
+    /*DC scans the buffer out every frame, keep flash and RLE textures pinned in ram*/
+    void setTexture(const Qul::PlatformInterface::Texture &t)
+    {
+        /*RLE textures are decoded without padding, others keep their own line length*/
+        const TextureCache::Decoder decoder = rleDecoder(t.format());
+        const int newStride = decoder ? t.size().width() * bytesPerPixelFromPixelFormat(rleDecodedFormat(t.format()))
+                                      : t.bytesPerLine();
+        const std::size_t size = newStride * t.size().height();
+        const unsigned char *newBuffer = TextureCache::pin(t.data(), size, decoder, rleDataSize(t.data(), size));
+        if (!newBuffer) {
+            /*DC keeps scanning out the previous texture rather than address 0*/
+            printf("SDRVImageLayer cannot decode texture %p, keeping %p\n", t.data(), texture);
+            applyBuffer();
+            return;
+        }
+        SDRVLayerEngine::retireTexture(this, texture);
+        texture = t.data();
+        buffer = newBuffer;
+        stride = newStride;
+        applyBuffer();
+
+        /*photos and backgrounds with an unused alpha channel are copied by g2d*/
+        const OpaqueMap::Source opaqueSource = {texture,
+                                                buffer,
+                                                rleDecodedFormat(t.format()),
+                                                t.size().width(),
+                                                t.size().height(),
+                                                stride};
+        setOpaque(OpaqueMap::isOpaque(opaqueSource));
+    }
+
+    /*property updates reset the stride to the packed width, the layer stays off until a texture is pinned*/
+    void applyBuffer()
+    {
+        if (!buffer) {
+            m_dcLayer.layer_en = 0;
+            m_g2dLayer.layer_en = 0;
+            return;
+        }
+        setHwLayerBuffer(buffer, stride);
     }
-    unsigned char *framebuffers;
+
+    const unsigned char *texture = NULL;
+    const unsigned char *buffer = NULL;
+    int stride = 0;
 };
 
+void SDRVLayerEngine::retireTexture(SDRVHardwareLayer *layer, const unsigned char *data)
+{
+    if (!data)
+        return;
+    SDRVScreenState *state = screenState(screenOfLayer(layer));
+    if (!state) {
+        /*not on a screen yet, DC never saw it*/
+        TextureCache::unpin(data);
+        return;
+    }
+    const SDRVRetiredTexture retired = {data, state->screenIndex, Compositor::nextFrame(state->screenIndex)};
+    mRetiredTextures.push_back(retired);
+}
+
+/*same rule as SDRVBufferPool: free once a later frame than the last one showing it is posted*/
+void SDRVLayerEngine::unpinRetiredTextures()
+{
+    RetiredTextureVec::iterator it = mRetiredTextures.begin();
+    while (it != mRetiredTextures.end()) {
+        if (Compositor::postedFrames(it->screenIndex) >= it->frame) {
+            TextureCache::unpin(it->data);
+            it = mRetiredTextures.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 /*g2d init*/
 int SDRVLayerEngine::init()
 {
     //printf("SDRV SDRVLayerEngine init start\n");
-    if (!hal_g2dlite_creat_handle(&G2D, RES_G2D_G2D2)) 
-        printf("g2dlite creat handle failed\n");
-
-    hal_g2dlite_init(G2D);
-    printf("g2d->index 0x%x\n", ((struct g2dlite *)G2D)->index);
+    G2D = g2dHandle();
+    return G2D ? DEFAULT_STATUS : ERROR_STATUS;
 }
 
 /*init display*/
 int SDRVLayerEngine::initDisplay(const PlatformInterface::Screen *screen)
 {
     //printf("SDRV SDRVLayerEngine initDisplay start %p\n", screen);
-    //TODO: For multidisplay,screen name should config
+    return screenState(screen) ? DEFAULT_STATUS : ERROR_STATUS;
+}
+
+/*find or create the composition state of screen*/
+SDRVScreenState *SDRVLayerEngine::screenState(const PlatformInterface::Screen *screen)
+{
+    ScreenStateMap::iterator it = mScreenStateMap.find(screen);
+    if (it != mScreenStateMap.end())
+        return &it->second;
+
+    const int displayId = Screens::displayId(screen);
+    if (displayId < 0) {
+        printf("error: screenState unknown screen %p\n", screen);
+        return NULL;
+    }
+
+    sdm_display_t *display = NULL;
+    sdm_display_t *entry;
     struct list_node *head = sdm_get_display_list();
-    list_for_every_entry(head, m_sdm, sdm_display_t, node) {
-        if (m_sdm->handle->display_id == QT_DISPLAY_ID)
+    list_for_every_entry(head, entry, sdm_display_t, node) {
+        if (entry->handle->display_id == displayId) {
+            display = entry;
             break;
+        }
+    }
+    if (!display) {
+        printf("error: screenState no sdm display %d for screen %p\n", displayId, screen);
+        return NULL;
+    }
+    printf("QT display_id %d\n", display->handle->display_id);
+
+    SDRVScreenState state = {screen,
+                             Screens::indexOf(screen),
+                             display,
+                             {{DISPLAY_QT_LAYER_0, DISPLAY_QT_LAYER_1}, 0, 1},
+                             {NULL, NULL},
+                             0,
+                             0,
+                             false,
+                             1};
+    Compositor::start(state.screenIndex, display);
+    return &mScreenStateMap.insert(std::make_pair(screen, state)).first->second;
+}
+
+/*find the screen of a root layer, sprite children use the screen of their sprite layer*/
+const PlatformInterface::Screen *SDRVLayerEngine::screenOfLayer(SDRVHardwareLayer *layer)
+{
+    while (layer && layer->getParentLayer())
+        layer = layer->getParentLayer();
+
+    for (ScreenLayerVecMap::iterator it = mScreenRootLayerVecMap.begin(); it != mScreenRootLayerVecMap.end(); ++it) {
+        if (std::find(it->second.begin(), it->second.end(), layer) != it->second.end())
+            return it->first;
     }
-    printf("QT display_id %d\n", m_sdm->handle->display_id);
+    return NULL;
 }
 
 /*SpriteLayer compose*/
-int SDRVLayerEngine::bltSpriteLayer(const PlatformInterface::Screen *screen)
+int SDRVLayerEngine::bltSpriteLayer(SDRVScreenState *state)
 {
-    //printf("SDRV SDRVLayerEngine bltSpriteLayer start %p\n", screen);
+    //printf("SDRV SDRVLayerEngine bltSpriteLayer start %p\n", state->screen);
+    SDRV_PROFILE_SCOPE(Phase_SpriteCompose);
 
-    std::vector<SDRVHardwareLayer *> layers = findRootLayerWithType(screen, SDRVLayerType::SDRV_SPRITE_LAYER);
-    std::vector<SDRVHardwareLayer *>::iterator iter = layers.begin();
-    while (iter != layers.end()) {
+    std::vector<SDRVHardwareLayer *>::iterator iter = state->committedLayers.begin();
+    while (iter != state->committedLayers.end()) {
         SDRVHardwareLayer * layer = *iter++;
+        if (layer->getSdrvLayerType() != SDRVLayerType::SDRV_SPRITE_LAYER)
+            continue;
         //printf("SDRV SDRVLayerEngine bltSpriteLayer layer: %p start\n", layer);
         static_cast<SDRVSpriteLayer *>(layer)->bltChildLayer();
         //printf("SDRV SDRVLayerEngine bltSpriteLayer layer: %p end\n", layer);
         static_cast<SDRVSpriteLayer *>(layer)->swap();
     }
-    //printf("SDRV SDRVLayerEngine bltSpriteLayer end %p\n", screen);
+    //printf("SDRV SDRVLayerEngine bltSpriteLayer end %p\n", state->screen);
     return DEFAULT_STATUS;
 }
 
 /*use dc compose layer to post screen*/
-int SDRVLayerEngine::bltRootLayer(const PlatformInterface::Screen *screen)
+int SDRVLayerEngine::bltRootLayer(SDRVScreenState *state, Compositor::ComposedFrame &frame)
 {
-    //printf("SDRV SDRVLayerEngine bltRootLayer start %p\n", screen);
-    std::vector<SDRVHardwareLayer *> layers = findAllRootLayer(screen);
+    //printf("SDRV SDRVLayerEngine bltRootLayer start %p\n", state->screen);
+    const PlatformInterface::Screen *screen = state->screen;
+    struct sdm_buffer *sdm_bufs = frame.bufs;
+    unsigned char **rootFrameBuffer = state->rootFrameBuffer;
+    int &rootFrameBufferIndex = state->rootFrameBufferIndex;
+    std::vector<SDRVHardwareLayer *> layers = state->committedLayers;
 
     if (layers.size() == 0) {
         printf("error: bltRootLayer screen %p root layer num is 0\n", screen);
         return ERROR_STATUS;
     }
+    if (layers.size() <= getDCHwLayerNum() && rootFrameBuffer[0]
+        && ++state->framesWithoutRootCompose > ROOT_COMPOSE_RELEASE_FRAMES) {
+        // DC can show all layers directly again, the compose buffers are not
+        // scanned out anymore
+        releaseScreenBuffers(ScreenBufferUser_RootCompose, state->screenIndex);
+        rootFrameBuffer[0] = rootFrameBuffer[1] = NULL;
+    }
     if (layers.size() == 1) {
         printf("warn: bltRootLayer screen %p root layer num is 1, suggest use 2 layer\n", screen);
-        sdm_bufs[0] = layers[0]->getSdmBufferConfig();
+        sdm_bufs[0] = layers[0]->getCommittedSdmBufferConfig();
         sdm_bufs[0].z_order = 0;//force set z_order to 0
-        post_data.n_bufs    = 1;
+        frame.bufCount = 1;
     }
     else if (layers.size() == getDCHwLayerNum()) {
-        sdm_bufs[0] = layers[0]->getSdmBufferConfig();
-        sdm_bufs[1] = layers[1]->getSdmBufferConfig();
-        post_data.n_bufs = 2;
+        sdm_bufs[0] = layers[0]->getCommittedSdmBufferConfig();
+        sdm_bufs[1] = layers[1]->getCommittedSdmBufferConfig();
+        frame.bufCount = 2;
     }
     else if (layers.size() > getDCHwLayerNum()) {
+        SDRV_PROFILE_SCOPE(Phase_RootCompose);
         //printf("warn: bltRootLayer screen %p root layer num > 2, suggest use 2 layer\n", screen);
         //printf("SDRV rootFrameBufferIndex %d\n", rootFrameBufferIndex);
         //TODO: should use g2d blend first
-        if (rootFrameBuffer[rootFrameBufferIndex] == NULL) {
-            rootFrameBuffer[rootFrameBufferIndex] = (unsigned char*) qul_malloc(
-                screen->size().width() * screen->size().height() * 4);
+        state->framesWithoutRootCompose = 0;
+        /*the compose buffer of two frames ago may still be on the display, the post task posts in order anyway*/
+        if (!Compositor::isPostTask(state->screenIndex)) {
+            const uint64_t waitStartUs = clockUs();
+            Compositor::waitUntilPosted(state->screenIndex);
+            framePacer.excludeWait(clockUs() - waitStartUs);
         }
+        rootFrameBuffer[rootFrameBufferIndex] = acquireScreenBuffer(ScreenBufferUser_RootCompose,
+                                                                    state->screenIndex,
+                                                                    rootFrameBufferIndex,
+                                                                    screen->size().width() * screen->size().height() * 4);
+        if (rootFrameBuffer[rootFrameBufferIndex] == NULL)
+            return ERROR_STATUS;
 
         // sort by zorder
         sort(layers.begin(),layers.end(),compare_z);
 
+        G2DLocker g2dLocker;
         struct g2dlite_input input;
         memset(&input, 0, sizeof(g2dlite_input));
         //printf("SDRV bltRootLayer  layers[0]=%p\n", layers[0]);
-        input.layer[input.layer_num] = layers[0]->getG2dInputConfig();
+        input.layer[input.layer_num] = layers[0]->getCommittedG2dInputConfig();
         input.layer[input.layer_num].zorder = 0;
         input.layer[input.layer_num].layer  = 0;
         input.layer_num++;
@@ -702,7 +959,7 @@ int SDRVLayerEngine::bltRootLayer(const PlatformInterface::Screen *screen)
         for (int i = 1; i <= layers.size()-2; i++) {
             //printf("SDRV bltRootLayer  layers[i]=%p\n", layers[i]);
             if (input.layer_num < 2) {
-                input.layer[input.layer_num] = layers[i]->getG2dInputConfig();
+                input.layer[input.layer_num] = layers[i]->getCommittedG2dInputConfig();
                 input.layer[input.layer_num].zorder = 1;
                 input.layer[input.layer_num].layer  = 1;
                 input.layer_num++;
@@ -739,9 +996,9 @@ int SDRVLayerEngine::bltRootLayer(const PlatformInterface::Screen *screen)
         sdm_bufs[0] = DISPLAY_QT_LAYER_0;
         sdm_bufs[0].addr[0] = (unsigned long)(rootFrameBuffer[rootFrameBufferIndex]);
         //printf("SDRV bltRootLayer   layers[layers.size()-1]=%p\n",  layers[layers.size()-1]);
-        sdm_bufs[1] = layers[layers.size()-1]->getSdmBufferConfig();
+        sdm_bufs[1] = layers[layers.size()-1]->getCommittedSdmBufferConfig();
         sdm_bufs[1].z_order = 1;
-        post_data.n_bufs    = 2;
+        frame.bufCount = 2;
 
         rootFrameBufferIndex = !rootFrameBufferIndex;
     }
@@ -753,16 +1010,81 @@ int SDRVLayerEngine::bltRootLayer(const PlatformInterface::Screen *screen)
     //printf("SDRV dst1 %d,%d,%d,%d \n", sdm_bufs[1].dst.x, sdm_bufs[1].dst.y, sdm_bufs[1].dst.w, sdm_bufs[1].dst.h);
     //printf("SDRV other1 %p,%d,%d,%d,%d,%d,0x%x,%d \n", sdm_bufs[1].addr[0], sdm_bufs[1].layer, sdm_bufs[1].layer_en, sdm_bufs[1].fmt, sdm_bufs[1].src_stride[0], sdm_bufs[1].z_order, sdm_bufs[1].alpha, sdm_bufs[1].alpha_en);
 
-    post_data.bufs             = sdm_bufs;
-    post_data.custom_data      = NULL;
-    post_data.custom_data_size = 0;
-
-    //post to screen
-    sdm_post(m_sdm->handle, &post_data);
     //printf("SDRV SDRVLayerEngine bltSpriteLayer end %p\n", screen);
     return DEFAULT_STATUS;
 }
 
+/*snapshot layer configs, mark the item layer buffers going into frame*/
+static void commitLayer(SDRVHardwareLayer *layer, uint32_t frame)
+{
+    layer->commit();
+    if (layer->getSdrvLayerType() == SDRVLayerType::SDRV_ITEM_LAYER)
+        static_cast<SDRVItemLayer *>(layer)->pool.markUsed(frame);
+
+    if (layer->getSdrvLayerType() != SDRVLayerType::SDRV_SPRITE_LAYER)
+        return;
+
+    SDRVSpriteLayer *sprite = static_cast<SDRVSpriteLayer *>(layer);
+    sprite->mCommittedChildLayers.clear();
+    sprite->mCommittedChildren.clear();
+    for (SpriteChildMap::iterator it = sprite->mSpriteChildMap.begin(); it != sprite->mSpriteChildMap.end(); ++it) {
+        commitLayer(it->second, frame);
+        sprite->mCommittedChildLayers.push_back(it->second);
+        sprite->mCommittedChildren.push_back(it->second->getCommittedG2dInputConfig());
+    }
+}
+
+/*hand the current layer state of the screen over to composition*/
+void SDRVLayerEngine::commitFrame(SDRVScreenState *state)
+{
+    unpinRetiredTextures();
+    const uint32_t frame = Compositor::nextFrame(state->screenIndex);
+    state->committedLayers = findAllRootLayer(state->screen);
+    for (size_t i = 0; i < state->committedLayers.size(); i++)
+        commitLayer(state->committedLayers[i], frame);
+}
+
+/*late-latch the committed configs of the frame right before they are composed*/
+void SDRVLayerEngine::applyLateLatches(SDRVScreenState *state, int refreshInterval)
+{
+    if (mLateLatchMap.empty())
+        return;
+
+    /*the screen's own vsync, the pacer only knows the first screen's*/
+    uint64_t presentUs = Compositor::predictPresentUs(state->screenIndex, refreshInterval);
+    if (!presentUs)
+        presentUs = framePacer.predictNextVsyncUs(clockUs());
+    for (size_t i = 0; i < state->committedLayers.size(); i++) {
+        SDRVHardwareLayer *layer = state->committedLayers[i];
+        applyLateLatch(state->screen, SDRV_LATE_LATCH_ROOT_LAYER, layer, presentUs);
+        if (layer->getSdrvLayerType() != SDRVLayerType::SDRV_SPRITE_LAYER)
+            continue;
+
+        SDRVSpriteLayer *sprite = static_cast<SDRVSpriteLayer *>(layer);
+        for (size_t j = 0; j < sprite->mCommittedChildLayers.size(); j++) {
+            SDRVHardwareLayer *child = sprite->mCommittedChildLayers[j];
+            applyLateLatch(state->screen, sprite->getZorder(), child, presentUs);
+            sprite->mCommittedChildren[j] = child->getCommittedG2dInputConfig();
+        }
+    }
+}
+
+/*sprite compose, root compose and the display layers of a committed frame*/
+bool SDRVLayerEngine::composeFrame(Compositor::ComposedFrame &frame, void *screenState)
+{
+    SDRVScreenState *state = static_cast<SDRVScreenState *>(screenState);
+    applyLateLatches(state, frame.refreshInterval);
+    bltSpriteLayer(state);
+    return bltRootLayer(state, frame) == DEFAULT_STATUS;
+}
+
+/*layers and their buffers are about to change under the compositors*/
+void SDRVLayerEngine::waitForCompositors()
+{
+    for (ScreenStateMap::iterator it = mScreenStateMap.begin(); it != mScreenStateMap.end(); ++it)
+        Compositor::waitUntilPosted(it->second.screenIndex);
+}
+
 /*add layer to Rootlayer*/
 int SDRVLayerEngine::addRootLayer(const PlatformInterface::Screen *screen, SDRVHardwareLayer *layer)
 {
@@ -857,12 +1179,30 @@ int SDRVLayerEngine::getScreenNum()
 
 /*Frame flash begin*/
 PlatformInterface::DrawingDevice *SDRVLayerEngine::beginFrame(const PlatformInterface::LayerEngine::ItemLayer *layer,
-                                                              const PlatformInterface::Rect &,
+                                                              const PlatformInterface::Rect &rect,
                                                               int refreshInterval)
 {
     //printf("SDRV SDRVLayerEngine beginFrame start %p, %d, %d\n", layer, refreshInterval, currentFrame);
+    SDRV_PROFILE_SCOPE(Phase_BeginFrame);
+    framePacer.setRequestedInterval(refreshInterval);
     auto itemLayer = const_cast<SDRVItemLayer *>(static_cast<const SDRVItemLayer *>(layer));
 
+    /*draw into a buffer no queued or displayed frame reads from*/
+    SDRVScreenState *state = screenState(screenOfLayer(itemLayer));
+    if (state)
+        state->refreshInterval = refreshInterval;
+    int index = itemLayer->pool.acquire(state ? Compositor::postedFrames(state->screenIndex) : 0);
+    if (index < 0) {
+        /*back-pressure from the compositor is no rendering cost for the pacer*/
+        const uint64_t waitStartUs = clockUs();
+        while ((index = itemLayer->pool.acquire(state ? Compositor::postedFrames(state->screenIndex) : 0)) < 0)
+            waitForEngineWakeup(Wakeup_Compositor, COMPOSITOR_WAIT_MS);
+        framePacer.excludeWait(clockUs() - waitStartUs);
+    }
+    itemLayer->drawIndex = index;
+    itemLayer->drawRect = rect;
+    itemLayer->copyForward();
+
     unsigned char *bits = itemLayer->getNextDrawBuffer();
     //printf("SDRV SDRVLayerEngine beginFrame nextdrawbuf %p\n", bits);
 
@@ -877,11 +1217,19 @@ void SDRVLayerEngine::endFrame(const PlatformInterface::LayerEngine::ItemLayer *
 {
 
     //printf("SDRV SDRVLayerEngine endFrame start %p, %d\n", layer, currentFrame);
+    SDRV_PROFILE_SCOPE(Phase_EndFrame);
     auto itemLayer = const_cast<SDRVItemLayer *>(static_cast<const SDRVItemLayer *>(layer));
 
     //sw need clean cache
     unsigned char *bits = itemLayer->getNextDrawBuffer();
+#if SDRV_TILED_FRAMEBUFFER
+    /*only the tiles the cpu fallbacks wrote, g2d writes bypass the cache*/
+    SDRVItemDrawingDevice &device = itemLayer->drawingDevice;
+    device.cpuTiles.cleanCache(bits, device.bytesPerLine(), bytesPerPixelFromPixelFormat(device.format()));
+    device.cpuTiles.clear();
+#else
     arch_clean_cache_range((addr_t)bits, itemLayer->getFrameBufferSize());
+#endif
 
     itemLayer->swap();
     //printf("SDRV SDRVLayerEngine endFrame end\n");
@@ -899,13 +1247,91 @@ FrameStatistics SDRVLayerEngine::presentFrame(const PlatformInterface::Screen *s
     PlatformInterface::Rgba32 color = screen->backgroundColor();
     //TODO:
     // HW_SetScreenBackgroundColor(color.red(), color.blue(), color.green());
-    bltSpriteLayer(screen);
-
-    bltRootLayer(screen);
+    SDRVScreenState *state = screenState(screen);
+    if (!state)
+        return FrameStatistics();
+
+#if SDRV_COMPOSE_PIPELINE
+    /*composition is the compositor task's work, waiting for it is no frame cost*/
+    framePacer.frameRendered(clockUs());
+    /*the previous frame still reads the committed configs*/
+    Compositor::waitUntilComposed(state->screenIndex);
+#endif
+    commitFrame(state);
+    Compositor::ComposedFrame &frame = state->frame;
+    frame.refreshInterval = state->refreshInterval;
+#if SDRV_COMPOSE_PIPELINE
+    frame.compose = composeFrame;
+    frame.composeData = state;
+#else
+    frame.compose = NULL;
+    frame.composeData = NULL;
+    if (!composeFrame(frame, state))
+        frame.bufCount = 0;
+    framePacer.frameRendered(clockUs());
+#endif
+    {
+        SDRV_PROFILE_SCOPE(Phase_Post);
+        Compositor::submit(state->screenIndex, frame);
+    }
+    if (state->screenIndex == 0 && !state->framebuffersReleased) {
+        /*the framebuffer path stays on the display until the first layer frame is posted*/
+        Compositor::waitUntilPosted(state->screenIndex);
+        releaseFramebuffers();
+        state->framebuffersReleased = true;
+    }
+    framePacer.framePresented(clockUs());
     // No frame skip compensation implemented for layers
     return FrameStatistics();
 }
 
+/*register late-latch callback for screen layer z*/
+int SDRVLayerEngine::setLateLatchCallback(const PlatformInterface::Screen *screen,
+                                          int z,
+                                          SDRVLateLatchCallback callback,
+                                          void *userData)
+{
+    return setSpriteChildLateLatchCallback(screen, SDRV_LATE_LATCH_ROOT_LAYER, z, callback, userData);
+}
+
+/*register late-latch callback for child z of the sprite layer spriteZ*/
+int SDRVLayerEngine::setSpriteChildLateLatchCallback(const PlatformInterface::Screen *screen,
+                                                     int spriteZ,
+                                                     int z,
+                                                     SDRVLateLatchCallback callback,
+                                                     void *userData)
+{
+    if (!screen)
+        return ERROR_STATUS;
+
+    /*the post tasks read the map while composing*/
+    waitForCompositors();
+    const SDRVLateLatchKey key = {screen, spriteZ, z};
+    if (!callback) {
+        mLateLatchMap.erase(key);
+        return DEFAULT_STATUS;
+    }
+
+    SDRVLateLatch latch = {callback, userData};
+    mLateLatchMap[key] = latch;
+    return DEFAULT_STATUS;
+}
+
+/*run late-latch callback of a root layer or sprite child, just before compose*/
+void SDRVLayerEngine::applyLateLatch(const PlatformInterface::Screen *screen,
+                                     int spriteZ,
+                                     SDRVHardwareLayer *layer,
+                                     uint64_t presentUs)
+{
+    if (mLateLatchMap.empty())
+        return;
+
+    const SDRVLateLatchKey key = {screen, spriteZ, layer->getZorder()};
+    LateLatchMap::iterator it = mLateLatchMap.find(key);
+    if (it != mLateLatchMap.end())
+        layer->applyLateLatch(it->second.callback, it->second.userData, presentUs);
+}
+
 /*Allocates an item layer for rendering dynamic content.*/
 PlatformInterface::LayerEngine::ItemLayer *SDRVLayerEngine::allocateItemLayer(const PlatformInterface::Screen *screen,
                                                                               const ItemLayerProperties &props,
@@ -913,6 +1339,12 @@ PlatformInterface::LayerEngine::ItemLayer *SDRVLayerEngine::allocateItemLayer(co
 {
     //printf("SDRV allocateItemLayer\n");
     SDRVItemLayer *layer = new SDRVItemLayer(props, static_cast<SDRVSpriteLayer *>(spriteLayer));
+    /*without a buffer beginFrame would wait for one forever*/
+    if (!layer->pool.count()) {
+        printf("SDRV allocateItemLayer: no buffer for %dx%d layer\n", props.size.width(), props.size.height());
+        delete layer;
+        return NULL;
+    }
 
     if (spriteLayer)
         static_cast<SDRVSpriteLayer *>(spriteLayer)->addChildLayer(static_cast<SDRVHardwareLayer *>(layer));
@@ -951,6 +1383,7 @@ PlatformInterface::LayerEngine::SpriteLayer *SDRVLayerEngine::allocateSpriteLaye
 /*Deallocates an item layer.*/
 void SDRVLayerEngine::deallocateItemLayer(PlatformInterface::LayerEngine::ItemLayer *layer)
 {
+    waitForCompositors();
     //printf("SDRV deallocateItemLayer %p\n", layer);
     SDRVHardwareLayer *  hwlayer = (static_cast<SDRVHardwareLayer *>(static_cast<SDRVItemLayer *>(layer)));
     if (hwlayer) {
@@ -968,9 +1401,13 @@ void SDRVLayerEngine::deallocateItemLayer(PlatformInterface::LayerEngine::ItemLa
 /*Deallocates an image layer.*/
 void SDRVLayerEngine::deallocateImageLayer(PlatformInterface::LayerEngine::ImageLayer *layer)
 {
+    waitForCompositors();
     //printf("SDRV deallocateImageLayer %p\n", layer);
     SDRVHardwareLayer *  hwlayer = (static_cast<SDRVHardwareLayer *>(static_cast<SDRVImageLayer *>(layer)));
     if (hwlayer) {
+        /*the last posted frame still shows it, resolve the screen before the layer leaves it*/
+        retireTexture(hwlayer, static_cast<SDRVImageLayer *>(layer)->texture);
+        static_cast<SDRVImageLayer *>(layer)->texture = NULL;
         if (hwlayer->isRootLayer())
             delRootLayer(hwlayer);
         else {
@@ -985,6 +1422,7 @@ void SDRVLayerEngine::deallocateImageLayer(PlatformInterface::LayerEngine::Image
 /*Deallocates a sprite layer.*/
 void SDRVLayerEngine::deallocateSpriteLayer(PlatformInterface::LayerEngine::SpriteLayer *layer)
 {
+    waitForCompositors();
     //printf("SDRV deallocateSpriteLayer %p\n", layer);
     delRootLayer(static_cast<SDRVHardwareLayer *>(static_cast<SDRVSpriteLayer *>(layer)));
     delete static_cast<SDRVSpriteLayer *>(layer);
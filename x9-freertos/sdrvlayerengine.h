@@ -28,6 +28,7 @@ namespace sdm {
 }
 
 #include "disp_data_type.h"
+#include "sdrvcompositor.h"
 #include <vector>
 #include <map>
 
@@ -105,7 +106,6 @@ using namespace sdm;
 }
 
 #define USE_HW_ACC     0
-#define RES_G2D_G2D2   0x4362200A
 #define DCHWLAYERNUM   2
 #define ERROR_STATUS  -1
 #define DEFAULT_STATUS 0
@@ -113,7 +113,6 @@ using namespace sdm;
 #define THREE_BIT      3
 #define TWO_BIT        2 
 
-static int QT_DISPLAY_ID = SCREEN_1;
 static void *G2D = NULL;
 
 struct g2dlite {
@@ -122,10 +121,6 @@ struct g2dlite {
     uint32_t irq_num;
 };
 
-static sdm_display_t * m_sdm;
-static struct sdm_buffer sdm_bufs[2] = {DISPLAY_QT_LAYER_0, DISPLAY_QT_LAYER_1};
-static struct sdm_post_config post_data;
-
 namespace Qul {
 namespace Platform {
 
@@ -135,6 +130,23 @@ enum SDRVLayerType{
     SDRV_SPRITE_LAYER
 };
 
+/*late-latch state of one layer, see SDRVLayerEngine::setLateLatchCallback*/
+struct SDRVLateLatchState
+{
+    /*predicted scan out time of this frame in us (clockUs)*/
+    uint64_t presentUs;
+    bool enabled;
+    int x;
+    int y;
+    float opacity;
+    /*layer buffer, may be replaced with a pre-rendered buffer of the same size*/
+    const unsigned char *buffer;
+    int stride;
+};
+
+/*return true if state was changed*/
+typedef bool (*SDRVLateLatchCallback)(SDRVLateLatchState &state, void *userData);
+
 class SDRVDrawingEngine : public PlatformInterface::DrawingEngine
 {
     void blendImage(Qul::PlatformInterface::DrawingDevice *drawingDevice, 
@@ -191,8 +203,16 @@ struct SDRVHardwareLayer
     Qul::PlatformInterface::Size getSize() { return m_size;}
     sdm_buffer getSdmBufferConfig(){return m_dcLayer;}
     g2dlite_input_cfg getG2dInputConfig(){return m_g2dLayer;}
+    /*snapshot of the configs the compositor works with, taken when a frame is handed over*/
+    void commit(){ m_committedDcLayer = m_dcLayer; m_committedG2dLayer = m_g2dLayer;}
+    sdm_buffer getCommittedSdmBufferConfig(){return m_committedDcLayer;}
+    g2dlite_input_cfg getCommittedG2dInputConfig(){return m_committedG2dLayer;}
+    void setCommittedBuffer(const unsigned char *buf);
     SDRVLayerType getSdrvLayerType(){return m_type;}
     SDRVHardwareLayer* getParentLayer(){return m_parentlayer;}
+    /*only changes the committed configs, the next commit starts from the layer properties again*/
+    void applyLateLatch(SDRVLateLatchCallback callback, void *userData, uint64_t presentUs);
+    void setOpaque(bool opaque);
 
     /*layer Properties*/
     Qul::PlatformInterface::LayerEngine::LayerPropertiesBase m_props;
@@ -205,6 +225,9 @@ struct SDRVHardwareLayer
     sdm_buffer m_dcLayer;
     /*usr g2d compose layer*/
     g2dlite_input_cfg m_g2dLayer;
+    /*committed dc and g2d configs, only read by composition*/
+    sdm_buffer m_committedDcLayer;
+    g2dlite_input_cfg m_committedG2dLayer;
     /*parent layer*/
     SDRVHardwareLayer* m_parentlayer;
     /*current layer status ,rootlayer or normal layer*/
@@ -213,10 +236,64 @@ struct SDRVHardwareLayer
     int m_zorder;
     /*hardware pixel format*/
     int m_hwPixelFormat;
+    /*every pixel opaque, g2d copies the layer instead of blending it*/
+    bool m_opaque;
 };
 
 typedef std::map<const PlatformInterface::Screen *, std::vector<SDRVHardwareLayer *> > ScreenLayerVecMap;
 typedef std::map<int, SDRVHardwareLayer *> SpriteChildMap;
+struct SDRVLateLatch
+{
+    SDRVLateLatchCallback callback;
+    void *userData;
+};
+/*root layers are keyed by their z-order, sprite children by the z-order of their sprite layer and their own*/
+struct SDRVLateLatchKey
+{
+    const PlatformInterface::Screen *screen;
+    int spriteZ;
+    int z;
+    bool operator<(const SDRVLateLatchKey &other) const
+    {
+        if (screen != other.screen)
+            return screen < other.screen;
+        if (spriteZ != other.spriteZ)
+            return spriteZ < other.spriteZ;
+        return z < other.z;
+    }
+};
+/*spriteZ of root layers*/
+#define SDRV_LATE_LATCH_ROOT_LAYER -1
+typedef std::map<SDRVLateLatchKey, SDRVLateLatch> LateLatchMap;
+
+/*composition state of one screen: its sdm display, the frame handed to its post task and the root compose buffers,
+  every screen is composed and posted on its own*/
+struct SDRVScreenState
+{
+    const PlatformInterface::Screen *screen;
+    int screenIndex;
+    sdm_display_t *display;
+    Compositor::ComposedFrame frame;
+    unsigned char *rootFrameBuffer[2];
+    int rootFrameBufferIndex;
+    int framesWithoutRootCompose;
+    /*the framebuffer path gave up its share of the screen buffers*/
+    bool framebuffersReleased;
+    /*refresh interval Qul requested for the screen with the last beginFrame*/
+    int refreshInterval;
+    /*root layers of the frame handed over last, owned by composition until it is composed*/
+    std::vector<SDRVHardwareLayer *> committedLayers;
+};
+typedef std::map<const PlatformInterface::Screen *, SDRVScreenState> ScreenStateMap;
+/*texture an image layer no longer shows, DC scans it out until the frame replacing it is posted*/
+struct SDRVRetiredTexture
+{
+    const unsigned char *data;
+    int screenIndex;
+    uint32_t frame;
+};
+typedef std::vector<SDRVRetiredTexture> RetiredTextureVec;
+
 static SDRVDrawingEngine sdrvDrawingEngine;
 
 class SDRVLayerEngine : public PlatformInterface::LayerEngine
@@ -225,8 +302,16 @@ public:
     int init();
     int initDisplay(const PlatformInterface::Screen *screen);
     static int getDCHwLayerNum(){ return DCHWLAYERNUM;}
-    static int bltSpriteLayer(const PlatformInterface::Screen *screen);
-    static int bltRootLayer(const PlatformInterface::Screen *screen);
+    static int bltSpriteLayer(SDRVScreenState *state);
+    static int bltRootLayer(SDRVScreenState *state, Compositor::ComposedFrame &frame);
+    /*snapshot the root layers of the screen for composition*/
+    static void commitFrame(SDRVScreenState *state);
+    /*compose a committed frame, on the engine task or the post task of the screen*/
+    static bool composeFrame(Compositor::ComposedFrame &frame, void *screenState);
+    /*run the late-latch callbacks on the committed configs, first step of composeFrame*/
+    static void applyLateLatches(SDRVScreenState *state, int refreshInterval);
+    /*wait until no compositor reads layers or buffers that are about to go away*/
+    static void waitForCompositors();
 
     int addRootLayer(const PlatformInterface::Screen *screen, SDRVHardwareLayer * layer);
     int delRootLayer(SDRVHardwareLayer * layer);
@@ -258,9 +343,36 @@ public:
                                                         int refreshInterval);
     static void endFrame(const PlatformInterface::LayerEngine::ItemLayer *);
     static FrameStatistics presentFrame(const PlatformInterface::Screen *screen, const PlatformInterface::Rect &rect);
+
+    /*register a callback updating the layer with the given z-order right before it is composed and posted,
+      pass NULL to unregister. With SDRV_COMPOSE_PIPELINE the callback runs on the post task of the screen,
+      it must not call into the layer engine*/
+    static int setLateLatchCallback(const PlatformInterface::Screen *screen,
+                                    int z,
+                                    SDRVLateLatchCallback callback,
+                                    void *userData);
+    /*same for the child with z-order z of the sprite layer with z-order spriteZ*/
+    static int setSpriteChildLateLatchCallback(const PlatformInterface::Screen *screen,
+                                               int spriteZ,
+                                               int z,
+                                               SDRVLateLatchCallback callback,
+                                               void *userData);
+    /*run the callback registered for the layer on its committed configs*/
+    static void applyLateLatch(const PlatformInterface::Screen *screen,
+                               int spriteZ,
+                               SDRVHardwareLayer *layer,
+                               uint64_t presentUs);
+    /*state of the screen, looks up its sdm display on first use, NULL for unknown screens*/
+    static SDRVScreenState *screenState(const PlatformInterface::Screen *screen);
+    /*screen the layer or its sprite layer was allocated on, NULL if not found*/
+    static const PlatformInterface::Screen *screenOfLayer(SDRVHardwareLayer *layer);
+    /*unpin a texture the layer stopped showing once the next frame of its screen is posted*/
+    static void retireTexture(SDRVHardwareLayer *layer, const unsigned char *data);
+    static void unpinRetiredTextures();
     static ScreenLayerVecMap mScreenRootLayerVecMap;
-    static unsigned char* rootFrameBuffer[2];
-    static int rootFrameBufferIndex;
+    static ScreenStateMap mScreenStateMap;
+    static LateLatchMap mLateLatchMap;
+    static RetiredTextureVec mRetiredTextures;
 };
 
 } // namespace Platform
@@ -0,0 +1,104 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVMPSCQUEUE_H
+#define SDRVMPSCQUEUE_H
+
+#include <cstdint>
+
+namespace Qul {
+namespace Platform {
+
+/*
+ * Bounded lock-free queue from any number of producers to one consumer.
+ * Producers may be tasks or interrupt handlers, including ones preempting
+ * each other: a producer claims a slot with a compare-and-swap on the tail
+ * and publishes it through the slot's sequence number, so no producer ever
+ * waits for another. The consumer stops at a claimed but not yet published
+ * slot. Items are copied in and out, Capacity must be a power of two.
+ */
+template<typename T, uint32_t Capacity>
+class SDRVMpscQueue
+{
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SDRVMpscQueue()
+        : m_head(0)
+        , m_tail(0)
+    {
+        for (uint32_t i = 0; i < Capacity; ++i)
+            m_slots[i].sequence = i;
+    }
+
+    // Producer side, false when the queue is full
+    bool push(const T &item)
+    {
+        uint32_t tail = __atomic_load_n(&m_tail, __ATOMIC_RELAXED);
+        Slot *slot;
+        while (true) {
+            slot = &m_slots[tail & (Capacity - 1)];
+            const int32_t diff = int32_t(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - tail);
+            if (diff == 0) {
+                if (__atomic_compare_exchange_n(&m_tail, &tail, tail + 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                tail = __atomic_load_n(&m_tail, __ATOMIC_RELAXED);
+            }
+        }
+        slot->item = item;
+        __atomic_store_n(&slot->sequence, tail + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Consumer side, false when the queue is empty or the oldest item is not published yet
+    bool pop(T &item)
+    {
+        Slot &slot = m_slots[m_head & (Capacity - 1)];
+        if (__atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE) != m_head + 1)
+            return false;
+        item = slot.item;
+        __atomic_store_n(&slot.sequence, m_head + Capacity, __ATOMIC_RELEASE);
+        ++m_head;
+        return true;
+    }
+
+    // Consumer side, claimed items including unpublished ones
+    uint32_t size() const { return __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE) - m_head; }
+    bool isEmpty() const { return size() == 0; }
+
+private:
+    struct Slot
+    {
+        uint32_t sequence;
+        T item;
+    };
+
+    Slot m_slots[Capacity];
+    uint32_t m_head;
+    uint32_t m_tail;
+};
+
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVMPSCQUEUE_H
@@ -0,0 +1,215 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvopaquemap.h"
+#include "sdrvallocator.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Qul {
+namespace Platform {
+namespace OpaqueMap {
+
+#define TILE_UNKNOWN 0
+
+struct Map
+{
+    const void *key;
+    int width;
+    int height;
+    unsigned char *tiles; /* Coverage + 1 per tile, TILE_UNKNOWN until scanned */
+    int tilesX;
+    int tilesY;
+    uint32_t lastUse;
+};
+
+static Map maps[SDRV_OPAQUE_MAP_TEXTURES];
+static uint32_t useCounter = 0;
+
+static bool hasAlpha(Qul::PixelFormat format)
+{
+    switch (format) {
+    case Qul::PixelFormat_RGB32:
+    case Qul::PixelFormat_RGB16:
+    case Qul::PixelFormat_RGB888:
+        return false;
+    default:
+        return true;
+    }
+}
+
+// Formats with an 8-bit alpha in the top byte of 32-bit pixels
+static bool isScannable(Qul::PixelFormat format)
+{
+    return format == Qul::PixelFormat_ARGB32 || format == Qul::PixelFormat_ARGB32_Premultiplied;
+}
+
+static Map *findMap(const Source &source)
+{
+    Map *victim = &maps[0];
+    for (int i = 0; i < SDRV_OPAQUE_MAP_TEXTURES; ++i) {
+        // Size guards against a freed image buffer reused for another image
+        if (maps[i].key == source.key && maps[i].width == source.width && maps[i].height == source.height)
+            return &maps[i];
+        if (maps[i].lastUse < victim->lastUse)
+            victim = &maps[i];
+    }
+
+    const int tilesX = (source.width + SDRV_OPAQUE_TILE_SIZE - 1) / SDRV_OPAQUE_TILE_SIZE;
+    const int tilesY = (source.height + SDRV_OPAQUE_TILE_SIZE - 1) / SDRV_OPAQUE_TILE_SIZE;
+    unsigned char *tiles = (unsigned char *)Allocator::allocate(tilesX * tilesY);
+    if (!tiles)
+        return NULL;
+    memset(tiles, TILE_UNKNOWN, tilesX * tilesY);
+
+    Allocator::release(victim->tiles);
+    victim->key = source.key;
+    victim->width = source.width;
+    victim->height = source.height;
+    victim->tiles = tiles;
+    victim->tilesX = tilesX;
+    victim->tilesY = tilesY;
+    return victim;
+}
+
+static Coverage scanTile(const Source &source, int tx, int ty)
+{
+    const int x0 = tx * SDRV_OPAQUE_TILE_SIZE;
+    const int y0 = ty * SDRV_OPAQUE_TILE_SIZE;
+    const int x1 = std::min(x0 + SDRV_OPAQUE_TILE_SIZE, source.width);
+    const int y1 = std::min(y0 + SDRV_OPAQUE_TILE_SIZE, source.height);
+
+    bool opaque = false;
+    bool transparent = false;
+    for (int y = y0; y < y1; ++y) {
+        const uint32_t *line = (const uint32_t *)(source.pixels + y * source.bytesPerLine);
+        for (int x = x0; x < x1; ++x) {
+            const uint32_t alpha = line[x] >> 24;
+            if (alpha == 0xff)
+                opaque = true;
+            else if (alpha == 0)
+                transparent = true;
+            else
+                return Coverage_Mixed;
+        }
+        if (opaque && transparent)
+            return Coverage_Mixed;
+    }
+    return opaque ? Coverage_Opaque : Coverage_Transparent;
+}
+
+static Coverage tileCoverage(Map &map, const Source &source, int tx, int ty)
+{
+    unsigned char &tile = map.tiles[ty * map.tilesX + tx];
+    if (tile == TILE_UNKNOWN)
+        tile = scanTile(source, tx, ty) + 1;
+    return Coverage(tile - 1);
+}
+
+bool forEachSpan(const Source &source, const PlatformInterface::Rect &rect, int maxSpans, SpanCallback callback, void *userData)
+{
+    if (rect.isEmpty())
+        return true;
+    if (!hasAlpha(source.format)) {
+        callback(rect, Coverage_Opaque, userData);
+        return true;
+    }
+    if (!isScannable(source.format))
+        return false;
+
+    Map *map = findMap(source);
+    if (!map)
+        return false;
+    map->lastUse = ++useCounter;
+
+    const int tx0 = rect.x() / SDRV_OPAQUE_TILE_SIZE;
+    const int ty0 = rect.y() / SDRV_OPAQUE_TILE_SIZE;
+    const int tx1 = (rect.x() + rect.width() - 1) / SDRV_OPAQUE_TILE_SIZE;
+    const int ty1 = (rect.y() + rect.height() - 1) / SDRV_OPAQUE_TILE_SIZE;
+
+    // Count the runs first, many small G2D jobs cost more than one blend
+    const Coverage first = tileCoverage(*map, source, tx0, ty0);
+    bool uniform = true;
+    int spans = 0;
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        int previous = -1;
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            const Coverage coverage = tileCoverage(*map, source, tx, ty);
+            if (coverage != previous) {
+                ++spans;
+                previous = coverage;
+            }
+            uniform = uniform && coverage == first;
+        }
+    }
+
+    if (uniform) {
+        callback(rect, first, userData);
+        return true;
+    }
+    if (spans > maxSpans)
+        return false;
+
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        const int y0 = std::max(rect.y(), ty * SDRV_OPAQUE_TILE_SIZE);
+        const int y1 = std::min(rect.y() + rect.height(), (ty + 1) * SDRV_OPAQUE_TILE_SIZE);
+        int runStart = tx0;
+        Coverage runCoverage = tileCoverage(*map, source, tx0, ty);
+        for (int tx = tx0 + 1; tx <= tx1 + 1; ++tx) {
+            const bool end = tx > tx1;
+            const Coverage coverage = end ? runCoverage : tileCoverage(*map, source, tx, ty);
+            if (!end && coverage == runCoverage)
+                continue;
+
+            const int x0 = std::max(rect.x(), runStart * SDRV_OPAQUE_TILE_SIZE);
+            const int x1 = std::min(rect.x() + rect.width(), tx * SDRV_OPAQUE_TILE_SIZE);
+            callback(PlatformInterface::Rect(x0, y0, x1 - x0, y1 - y0), runCoverage, userData);
+            runStart = tx;
+            runCoverage = coverage;
+        }
+    }
+    return true;
+}
+
+bool isOpaque(const Source &source)
+{
+    if (!hasAlpha(source.format))
+        return true;
+    if (!isScannable(source.format))
+        return false;
+
+    Map *map = findMap(source);
+    if (!map)
+        return false;
+    map->lastUse = ++useCounter;
+
+    for (int ty = 0; ty < map->tilesY; ++ty) {
+        for (int tx = 0; tx < map->tilesX; ++tx) {
+            if (tileCoverage(*map, source, tx, ty) != Coverage_Opaque)
+                return false;
+        }
+    }
+    return true;
+}
+
+} // namespace OpaqueMap
+} // namespace Platform
+} // namespace Qul
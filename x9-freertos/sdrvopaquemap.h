@@ -0,0 +1,71 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVOPAQUEMAP_H
+#define SDRVOPAQUEMAP_H
+
+#include <platforminterface/drawingdevice.h>
+#include <platforminterface/rect.h>
+
+// Texture tiles classified as opaque, transparent or mixed
+#ifndef SDRV_OPAQUE_TILE_SIZE
+#define SDRV_OPAQUE_TILE_SIZE 32
+#endif
+
+// Textures with a tile map, the least recently used map is dropped first
+#ifndef SDRV_OPAQUE_MAP_TEXTURES
+#define SDRV_OPAQUE_MAP_TEXTURES 32
+#endif
+
+namespace Qul {
+namespace Platform {
+namespace OpaqueMap {
+
+enum Coverage { Coverage_Transparent, Coverage_Opaque, Coverage_Mixed };
+
+struct Source
+{
+    const void *key;            // stable texture identity, e.g. Texture::data()
+    const unsigned char *pixels; // readable pixels, e.g. the decoded RLE copy
+    Qul::PixelFormat format;
+    int width;
+    int height;
+    int bytesPerLine;
+};
+
+typedef void (*SpanCallback)(const PlatformInterface::Rect &span, Coverage coverage, void *userData);
+
+/*
+ * Splits rect of the texture into horizontal runs of tiles with the same
+ * coverage and calls back for each, clipped to rect. Tiles are classified
+ * on first use and remembered per texture. Returns false without calling
+ * back if that takes more than maxSpans runs, then the caller should treat
+ * the whole rect as mixed.
+ */
+bool forEachSpan(const Source &source, const PlatformInterface::Rect &rect, int maxSpans, SpanCallback callback, void *userData);
+
+// Whether every pixel of the texture is opaque
+bool isOpaque(const Source &source);
+
+} // namespace OpaqueMap
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVOPAQUEMAP_H
@@ -0,0 +1,195 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvprofiler.h"
+
+#if SDRV_FRAME_PROFILER
+
+#include "sdrvclock.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace Qul {
+namespace Platform {
+namespace Profiler {
+
+#define WORST_FRAME_NUM 5
+
+struct FrameRecord
+{
+    uint32_t frameNumber;
+    uint32_t totalUs;
+    uint32_t phaseUs[Phase_Count];
+    // Phases run by other tasks (compositors) while this frame ran
+    uint32_t otherTaskUs[Phase_Count];
+};
+
+static const char *const phaseNames[Phase_Count] = {"engine",
+                                                    "beginFrame",
+                                                    "blendImage",
+                                                    "blendRect",
+                                                    "blendTransformed",
+                                                    "endFrame",
+                                                    "spriteCompose",
+                                                    "rootCompose",
+                                                    "sdm_post",
+                                                    "vsyncWait"};
+
+static FrameRecord frames[SDRV_PROFILER_FRAMES];
+static uint32_t scratch[SDRV_PROFILER_FRAMES];
+static uint32_t recordedFrames = 0;
+
+static FrameRecord current;
+static TaskHandle_t engineTask = NULL;
+static uint32_t otherTaskUs[Phase_Count];
+static uint64_t frameStartUs = 0;
+static bool inFrame = false;
+static bool frameRendered = false;
+
+uint64_t timestampUs()
+{
+    return clockUs();
+}
+
+void frameBegin()
+{
+    memset(&current, 0, sizeof(current));
+    engineTask = xTaskGetCurrentTaskHandle();
+    frameRendered = false;
+    inFrame = true;
+    frameStartUs = timestampUs();
+}
+
+void frameEnd()
+{
+    if (!inFrame)
+        return;
+    inFrame = false;
+
+    // Engine updates that only ran timers or bindings are not frames
+    if (!frameRendered)
+        return;
+
+    current.totalUs = uint32_t(timestampUs() - frameStartUs);
+    uint32_t nested = 0;
+    for (int i = Phase_EngineUpdate + 1; i < Phase_Count; ++i)
+        nested += current.phaseUs[i];
+    current.phaseUs[Phase_EngineUpdate] = current.totalUs > nested ? current.totalUs - nested : 0;
+    for (int i = 0; i < Phase_Count; ++i)
+        current.otherTaskUs[i] = __atomic_exchange_n(&otherTaskUs[i], 0, __ATOMIC_RELAXED);
+    current.frameNumber = recordedFrames;
+
+    frames[recordedFrames % SDRV_PROFILER_FRAMES] = current;
+    ++recordedFrames;
+}
+
+void addPhaseTime(Phase phase, uint32_t us)
+{
+    // The frame record belongs to the engine task, other tasks only add up
+    if (xTaskGetCurrentTaskHandle() != engineTask) {
+        __atomic_add_fetch(&otherTaskUs[phase], us, __ATOMIC_RELAXED);
+        return;
+    }
+    if (!inFrame)
+        return;
+    current.phaseUs[phase] += us;
+    frameRendered = true;
+}
+
+static uint32_t percentile(uint32_t *values, int count, int pct)
+{
+    int index = (count * pct) / 100;
+    if (index >= count)
+        index = count - 1;
+    std::nth_element(values, values + index, values + count);
+    return values[index];
+}
+
+void printReport()
+{
+    const int count = recordedFrames < SDRV_PROFILER_FRAMES ? recordedFrames : SDRV_PROFILER_FRAMES;
+    if (count == 0) {
+        printf("profiler: no frames recorded\n");
+        return;
+    }
+
+    printf("profiler: last %d frames (us)\n", count);
+    printf("%-18s %8s %8s %8s %8s %8s\n", "phase", "avg", "p50", "p90", "p99", "max");
+    // Engine task phases, then the ones the compositor tasks ran meanwhile
+    for (int row = -1; row < 2 * Phase_Count; ++row) {
+        const bool otherTask = row >= Phase_Count;
+        const int phase = otherTask ? row - Phase_Count : row;
+        uint64_t sum = 0;
+        uint32_t maxValue = 0;
+        for (int i = 0; i < count; ++i) {
+            scratch[i] = phase < 0 ? frames[i].totalUs
+                                   : otherTask ? frames[i].otherTaskUs[phase] : frames[i].phaseUs[phase];
+            sum += scratch[i];
+            maxValue = std::max(maxValue, scratch[i]);
+        }
+        if (maxValue == 0)
+            continue;
+
+        char name[24];
+        snprintf(name, sizeof(name), "%s%s", otherTask ? "task:" : "", phase < 0 ? "frame" : phaseNames[phase]);
+        const uint32_t p50 = percentile(scratch, count, 50);
+        const uint32_t p90 = percentile(scratch, count, 90);
+        const uint32_t p99 = percentile(scratch, count, 99);
+        printf("%-18s %8u %8u %8u %8u %8u\n", name, uint32_t(sum / count), p50, p90, p99, maxValue);
+    }
+
+    // Worst frames by total time, with their breakdown
+    int worst[WORST_FRAME_NUM];
+    int worstNum = 0;
+    for (int i = 0; i < count; ++i) {
+        int pos = worstNum;
+        while (pos > 0 && frames[worst[pos - 1]].totalUs < frames[i].totalUs)
+            --pos;
+        if (pos >= WORST_FRAME_NUM)
+            continue;
+        const int last = std::min(worstNum, WORST_FRAME_NUM - 1);
+        for (int j = last; j > pos; --j)
+            worst[j] = worst[j - 1];
+        worst[pos] = i;
+        if (worstNum < WORST_FRAME_NUM)
+            ++worstNum;
+    }
+
+    for (int i = 0; i < worstNum; ++i) {
+        const FrameRecord &record = frames[worst[i]];
+        printf("worst #%d: frame %u total %u us:", i, record.frameNumber, record.totalUs);
+        for (int phase = 0; phase < Phase_Count; ++phase) {
+            if (record.phaseUs[phase])
+                printf(" %s=%u", phaseNames[phase], record.phaseUs[phase]);
+        }
+        printf("\n");
+    }
+}
+
+} // namespace Profiler
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRV_FRAME_PROFILER
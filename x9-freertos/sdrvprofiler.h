@@ -0,0 +1,100 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVPROFILER_H
+#define SDRVPROFILER_H
+
+#include <cstdint>
+
+// Per-frame phase profiler. Enable with -DSDRV_FRAME_PROFILER=1
+// (QUL_X9_FRAME_PROFILER in CMake), otherwise all macros compile to nothing.
+// Phases timed on other tasks than the engine task, i.e. the compositor
+// tasks, are summed up separately and reported as "task:<phase>".
+#ifndef SDRV_FRAME_PROFILER
+#define SDRV_FRAME_PROFILER 0
+#endif
+
+// Number of frames kept in the ring buffer
+#ifndef SDRV_PROFILER_FRAMES
+#define SDRV_PROFILER_FRAMES 256
+#endif
+
+namespace Qul {
+namespace Platform {
+namespace Profiler {
+
+enum Phase {
+    Phase_EngineUpdate = 0,     /* updateEngine minus all phases below */
+    Phase_BeginFrame,
+    Phase_BlendImage,
+    Phase_BlendRect,
+    Phase_BlendTransformedImage,
+    Phase_EndFrame,             /* cache clean of the drawn buffer */
+    Phase_SpriteCompose,
+    Phase_RootCompose,
+    Phase_Post,                 /* sdm_post */
+    Phase_VsyncWait,
+    Phase_Count
+};
+
+#if SDRV_FRAME_PROFILER
+
+uint64_t timestampUs();
+void frameBegin();
+void frameEnd();
+void addPhaseTime(Phase phase, uint32_t us);
+void printReport();
+
+class ScopedPhase
+{
+public:
+    explicit ScopedPhase(Phase phase)
+        : m_phase(phase)
+        , m_start(timestampUs())
+    {}
+    ~ScopedPhase() { addPhaseTime(m_phase, uint32_t(timestampUs() - m_start)); }
+
+private:
+    Phase m_phase;
+    uint64_t m_start;
+};
+
+#define SDRV_PROFILE_CONCAT_(a, b) a##b
+#define SDRV_PROFILE_CONCAT(a, b) SDRV_PROFILE_CONCAT_(a, b)
+#define SDRV_PROFILE_SCOPE(phase) \
+    Qul::Platform::Profiler::ScopedPhase SDRV_PROFILE_CONCAT(sdrvProfileScope, __LINE__)(Qul::Platform::Profiler::phase)
+#define SDRV_PROFILE_FRAME_BEGIN() Qul::Platform::Profiler::frameBegin()
+#define SDRV_PROFILE_FRAME_END() Qul::Platform::Profiler::frameEnd()
+#define SDRV_PROFILE_REPORT() Qul::Platform::Profiler::printReport()
+
+#else
+
+#define SDRV_PROFILE_SCOPE(phase) do {} while (0)
+#define SDRV_PROFILE_FRAME_BEGIN() do {} while (0)
+#define SDRV_PROFILE_FRAME_END() do {} while (0)
+#define SDRV_PROFILE_REPORT() do {} while (0)
+
+#endif // SDRV_FRAME_PROFILER
+
+} // namespace Profiler
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVPROFILER_H
@@ -0,0 +1,94 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvrle.h"
+#include "sdrvassetpreload.h"
+
+#include <cstring>
+
+namespace Qul {
+namespace Platform {
+
+TextureCache::Decoder rleDecoder(Qul::PixelFormat format)
+{
+    switch (format) {
+    case Qul::PixelFormat_RLE_ARGB32:
+    case Qul::PixelFormat_RLE_ARGB32_Premultiplied:
+    case Qul::PixelFormat_RLE_RGB32:
+        return decodeRle32;
+    default:
+        return NULL;
+    }
+}
+
+Qul::PixelFormat rleDecodedFormat(Qul::PixelFormat format)
+{
+    switch (format) {
+    case Qul::PixelFormat_RLE_ARGB32:
+        return Qul::PixelFormat_ARGB32;
+    case Qul::PixelFormat_RLE_ARGB32_Premultiplied:
+        return Qul::PixelFormat_ARGB32_Premultiplied;
+    case Qul::PixelFormat_RLE_RGB32:
+        return Qul::PixelFormat_RGB32;
+    default:
+        return format;
+    }
+}
+
+bool decodeRle32(const unsigned char *src, std::size_t srcSize, unsigned char *dst, std::size_t size)
+{
+    const unsigned char *const srcEnd = src + srcSize;
+    uint32_t *out = (uint32_t *)dst;
+    uint32_t *const end = out + size / 4;
+
+    while (out < end) {
+        if (src == srcEnd)
+            return false;
+        const unsigned char header = *src++;
+        std::size_t count = (header & 0x7f) + 1;
+        if (count > std::size_t(end - out))
+            count = end - out;
+
+        if (header & 0x80) {
+            if (std::size_t(srcEnd - src) < 4)
+                return false;
+            uint32_t pixel;
+            memcpy(&pixel, src, 4);
+            src += 4;
+            for (std::size_t i = 0; i < count; ++i)
+                *out++ = pixel;
+        } else {
+            if (std::size_t(srcEnd - src) < count * 4)
+                return false;
+            memcpy(out, src, count * 4);
+            src += count * 4;
+            out += count;
+        }
+    }
+    return true;
+}
+
+std::size_t rleDataSize(const unsigned char *data, std::size_t size)
+{
+    return assetDataSize(data, size / 4 * 5);
+}
+
+} // namespace Platform
+} // namespace Qul
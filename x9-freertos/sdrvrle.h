@@ -0,0 +1,58 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVRLE_H
+#define SDRVRLE_H
+
+#include "sdrvtexturecache.h"
+
+#include <platforminterface/drawingdevice.h>
+
+namespace Qul {
+namespace Platform {
+
+/*
+ * Decoder for RLE compressed texture formats G2D can blend once decoded, NULL
+ * for other formats. The decoded pixels use 4 bytes, in the format returned
+ * by rleDecodedFormat().
+ */
+TextureCache::Decoder rleDecoder(Qul::PixelFormat format);
+Qul::PixelFormat rleDecodedFormat(Qul::PixelFormat format);
+
+/*
+ * Expands resource compiler RLE data: every chunk starts with a header byte,
+ * with the top bit set the next pixel repeats (header & 0x7f) + 1 times,
+ * otherwise header + 1 literal pixels follow. srcSize is the compressed size
+ * and size the decoded size. Returns false, without reading past srcSize, for
+ * data that ends before size bytes are decoded.
+ */
+bool decodeRle32(const unsigned char *src, std::size_t srcSize, unsigned char *dst, std::size_t size);
+
+/*
+ * Compressed size of RLE data decoding to size bytes, for the decoder bound:
+ * at most one header byte per pixel, cut at the end of the asset section
+ * holding data.
+ */
+std::size_t rleDataSize(const unsigned char *data, std::size_t size);
+
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVRLE_H
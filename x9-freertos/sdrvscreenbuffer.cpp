@@ -0,0 +1,99 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvscreenbuffer.h"
+#include "sdrvallocator.h"
+#include "sdrvscreens.h"
+
+#include <cstdio>
+
+namespace Qul {
+namespace Platform {
+
+struct ScreenBuffers
+{
+    unsigned char *buffers[2];
+    std::size_t bufferSizes[2];
+    unsigned int users;
+};
+
+static ScreenBuffers screenBuffers[SDRV_MAX_SCREENS];
+
+static void freeBuffers(ScreenBuffers &set)
+{
+    for (int i = 0; i < 2; ++i) {
+        Allocator::release(set.buffers[i]);
+        set.buffers[i] = NULL;
+        set.bufferSizes[i] = 0;
+    }
+}
+
+unsigned char *acquireScreenBuffer(ScreenBufferUser user, int screen, int index, std::size_t size)
+{
+    if (screen < 0 || screen >= SDRV_MAX_SCREENS)
+        return NULL;
+
+    ScreenBuffers &set = screenBuffers[screen];
+    if (set.buffers[index] && size > set.bufferSizes[index]) {
+        // Other users still draw into or scan out this buffer
+        if (set.users & ~user) {
+            printf("acquireScreenBuffer: screen %d buffers of %u bytes are shared, refusing to grow to %u\n",
+                   screen,
+                   (unsigned)set.bufferSizes[index],
+                   (unsigned)size);
+            return NULL;
+        }
+        // The caller is about to draw into this buffer, so the display has
+        // flipped away from it. The other one may still be on screen and is
+        // only replaced when it is acquired in turn.
+        Allocator::release(set.buffers[index]);
+        set.buffers[index] = NULL;
+        set.bufferSizes[index] = 0;
+    }
+
+    if (!set.buffers[index]) {
+        set.buffers[index] = (unsigned char *)Allocator::allocate(size, Allocator::Memory_Scanout);
+        if (!set.buffers[index]) {
+            printf("acquireScreenBuffer: allocating %u bytes for screen %d failed\n", (unsigned)size, screen);
+            return NULL;
+        }
+        set.bufferSizes[index] = size;
+    }
+
+    set.users |= user;
+    return set.buffers[index];
+}
+
+void releaseScreenBuffers(ScreenBufferUser user, int screen)
+{
+    if (screen < 0 || screen >= SDRV_MAX_SCREENS)
+        return;
+
+    ScreenBuffers &set = screenBuffers[screen];
+    if (!(set.users & user))
+        return;
+
+    set.users &= ~user;
+    if (!set.users)
+        freeBuffers(set);
+}
+
+} // namespace Platform
+} // namespace Qul
@@ -0,0 +1,50 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVSCREENBUFFER_H
+#define SDRVSCREENBUFFER_H
+
+#include <cstddef>
+
+namespace Qul {
+namespace Platform {
+
+// Full screen double buffers are shared by the single framebuffer path in
+// platform.cpp and the root layer composition of the layer engine. Every
+// screen (index into Screens::all()) has its own pair, allocated on first use
+// and freed when the last user of that screen releases them.
+enum ScreenBufferUser {
+    ScreenBufferUser_Framebuffer = 0x1,
+    ScreenBufferUser_RootCompose = 0x2
+};
+
+// Returns buffer index (0 or 1) of at least size bytes, NULL if out of memory.
+// A buffer only grows while user is its only holder, as the old one is freed.
+unsigned char *acquireScreenBuffer(ScreenBufferUser user, int screen, int index, std::size_t size);
+void releaseScreenBuffers(ScreenBufferUser user, int screen);
+
+// Drops the share of the framebuffer path in platform.cpp, once the layer
+// engine has its own frames on the first screen
+void releaseFramebuffers();
+
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVSCREENBUFFER_H
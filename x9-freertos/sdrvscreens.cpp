@@ -0,0 +1,174 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvscreens.h"
+
+#include <platform/platform.h>
+
+#include <lk_wrapper.h>
+#include <spinlock.h>
+#include "sdm_display.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "sdrvclock.h"
+
+#ifndef SDRV_SCREEN_COUNT
+#define SDRV_SCREEN_COUNT 1
+#endif
+#ifndef SDRV_SECOND_SCREEN_WIDTH
+#define SDRV_SECOND_SCREEN_WIDTH QUL_DEFAULT_SCREEN_WIDTH
+#endif
+#ifndef SDRV_SECOND_SCREEN_HEIGHT
+#define SDRV_SECOND_SCREEN_HEIGHT QUL_DEFAULT_SCREEN_HEIGHT
+#endif
+
+#if SDRV_SCREEN_COUNT < 1 || SDRV_SCREEN_COUNT > SDRV_MAX_SCREENS
+#error "SDRV_SCREEN_COUNT must be between 1 and SDRV_MAX_SCREENS"
+#endif
+
+namespace Qul {
+namespace Platform {
+namespace Screens {
+
+static const int displayIds[SDRV_MAX_SCREENS] = {SCREEN_1, SCREEN_2};
+
+static PlatformInterface::Screen screens[SDRV_MAX_SCREENS] = {
+    PlatformInterface::Screen(PlatformInterface::Size(QUL_DEFAULT_SCREEN_WIDTH, QUL_DEFAULT_SCREEN_HEIGHT), "screen1"),
+    PlatformInterface::Screen(PlatformInterface::Size(SDRV_SECOND_SCREEN_WIDTH, SDRV_SECOND_SCREEN_HEIGHT), "screen2"),
+};
+
+// Vsyncs averaged into the refresh period before it is trusted
+#define CALIBRATION_VSYNCS 32
+
+static volatile uint32_t vsyncs[SDRV_MAX_SCREENS] = {0};
+static TaskHandle_t volatile vsyncTasks[SDRV_MAX_SCREENS] = {NULL};
+
+// Refresh timing of each screen, written by its vsync interrupt
+struct VsyncTiming
+{
+    uint64_t firstUs;
+    uint64_t lastUs;
+    uint32_t periodUs;
+};
+
+static VsyncTiming vsyncTimings[SDRV_MAX_SCREENS];
+static spin_lock_t timingLock = SPIN_LOCK_INITIAL_VALUE;
+
+std::size_t count()
+{
+    return SDRV_SCREEN_COUNT;
+}
+
+PlatformInterface::Screen *all()
+{
+    return screens;
+}
+
+int indexOf(const PlatformInterface::Screen *screen)
+{
+    for (int i = 0; i < SDRV_SCREEN_COUNT; ++i) {
+        if (screen == &screens[i])
+            return i;
+    }
+    return -1;
+}
+
+int displayId(const PlatformInterface::Screen *screen)
+{
+    const int index = indexOf(screen);
+    return index < 0 ? -1 : displayIds[index];
+}
+
+void vsyncFromISR(int screen)
+{
+    if (screen < 0 || screen >= SDRV_MAX_SCREENS)
+        return;
+
+    const uint64_t nowUs = clockUs();
+    const uint32_t count = vsyncs[screen];
+    VsyncTiming &timing = vsyncTimings[screen];
+
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&timingLock, state);
+    if (count == 0) {
+        timing.firstUs = nowUs;
+    } else if (count <= CALIBRATION_VSYNCS) {
+        // Average over the first vsyncs to get the actual panel refresh rate
+        timing.periodUs = uint32_t((nowUs - timing.firstUs) / count);
+    } else {
+        // Track slow drift, ignoring vsyncs lost while interrupts were masked
+        const uint32_t delta = uint32_t(nowUs - timing.lastUs);
+        if (delta > timing.periodUs / 2 && delta < timing.periodUs + timing.periodUs / 2)
+            timing.periodUs = (timing.periodUs * 15 + delta) / 16;
+    }
+    timing.lastUs = nowUs;
+    spin_unlock_irqrestore(&timingLock, state);
+
+    vsyncs[screen] = count + 1;
+    TaskHandle_t task = vsyncTasks[screen];
+    if (!task)
+        return;
+
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &higherPriorityTaskWoken);
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+uint32_t vsyncCount(int screen)
+{
+    return screen < 0 || screen >= SDRV_MAX_SCREENS ? 0 : vsyncs[screen];
+}
+
+bool vsyncTiming(int screen, uint64_t *lastVsyncUs, uint32_t *periodUs)
+{
+    if (screen < 0 || screen >= SDRV_MAX_SCREENS || vsyncs[screen] <= CALIBRATION_VSYNCS)
+        return false;
+
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&timingLock, state);
+    *lastVsyncUs = vsyncTimings[screen].lastUs;
+    *periodUs = vsyncTimings[screen].periodUs;
+    spin_unlock_irqrestore(&timingLock, state);
+    return true;
+}
+
+uint64_t predictNextVsyncUs(int screen, uint64_t nowUs)
+{
+    uint64_t lastUs;
+    uint32_t periodUs;
+    if (!vsyncTiming(screen, &lastUs, &periodUs))
+        return 0;
+
+    if (lastUs > nowUs)
+        return lastUs;
+    return lastUs + ((nowUs - lastUs) / periodUs + 1) * periodUs;
+}
+
+void notifyOnVsync(int screen, bool enabled)
+{
+    if (screen >= 0 && screen < SDRV_MAX_SCREENS)
+        vsyncTasks[screen] = enabled ? xTaskGetCurrentTaskHandle() : NULL;
+}
+
+} // namespace Screens
+} // namespace Platform
+} // namespace Qul
@@ -0,0 +1,73 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVSCREENS_H
+#define SDRVSCREENS_H
+
+#include <platforminterface/screen.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Qul {
+namespace Platform {
+
+#define SDRV_MAX_SCREENS 2
+
+namespace Screens {
+
+// Screens reported by availableScreens, one per sdm display. The first one is
+// also the screen of the single framebuffer path, further screens are only
+// driven by the layer engine: they need layers, beginFrame refuses them.
+std::size_t count();
+PlatformInterface::Screen *all();
+
+// Index into all(), -1 for a screen the platform does not know
+int indexOf(const PlatformInterface::Screen *screen);
+
+// sdm display_id the screen is posted to, -1 for unknown screens
+int displayId(const PlatformInterface::Screen *screen);
+
+// To be called from the vsync interrupt of the screen's display
+void vsyncFromISR(int screen);
+
+// Vsyncs seen on the screen, stays 0 while its interrupt is not hooked up
+uint32_t vsyncCount(int screen);
+
+// Refresh timing of the screen as measured by its vsync interrupt: the time
+// of the last vsync on the clockUs() timebase and the period. This is the
+// only refresh measurement, the frame pacer reads the first screen's. False,
+// with the outputs untouched, until enough vsyncs have been averaged.
+bool vsyncTiming(int screen, uint64_t *lastVsyncUs, uint32_t *periodUs);
+
+// Time of the screen's first vsync after nowUs, extrapolated from
+// vsyncTiming(), 0 while that is not known yet
+uint64_t predictNextVsyncUs(int screen, uint64_t nowUs);
+
+// While enabled, the calling task gets a task notification on every vsync of
+// the screen. Only enable it around actual waits, an idle screen should not
+// wake anybody up.
+void notifyOnVsync(int screen, bool enabled);
+
+} // namespace Screens
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVSCREENS_H
@@ -0,0 +1,466 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvsoftjpeg.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace Qul {
+namespace Platform {
+namespace SoftJpeg {
+
+#define MAX_COMPONENTS 3
+#define MAX_SAMPLING   2
+
+// Natural order index of the n-th coefficient in the stream
+static const uint8_t zigzag[64] = {0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,
+                                   12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28,
+                                   35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+                                   58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+// Canonical Huffman table, decoded one bit at a time (ITU T.81 F.2.2.3)
+struct Huffman
+{
+    int32_t maxCode[17];
+    int32_t minCode[17];
+    int valuePtr[17];
+    uint8_t values[256];
+    bool defined;
+};
+
+struct Component
+{
+    int id;
+    int h;
+    int v;
+    int quant;
+    int dcTable;
+    int acTable;
+    int dcPredictor;
+};
+
+struct Decoder
+{
+    const unsigned char *data;
+    std::size_t size;
+    std::size_t pos;
+
+    uint16_t quant[4][64];
+    Huffman dc[4];
+    Huffman ac[4];
+    Component components[MAX_COMPONENTS];
+    int componentCount;
+    int width;
+    int height;
+    int hmax;
+    int vmax;
+    int restartInterval;
+
+    uint32_t bits;
+    int bitCount;
+    bool atMarker;
+    bool truncated;
+};
+
+// Tables are kept off the task stack, images are only decoded on the engine task
+static Decoder decoder;
+
+static inline int read16(const unsigned char *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static inline int clamp255(int value)
+{
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+// Next entropy coded byte, zeros once a marker or the end of the data is reached
+static int nextByte(Decoder &d)
+{
+    if (d.atMarker || d.pos >= d.size) {
+        d.truncated = d.truncated || d.pos >= d.size;
+        d.atMarker = true;
+        return 0;
+    }
+    const int byte = d.data[d.pos];
+    if (byte == 0xff) {
+        if (d.pos + 1 < d.size && d.data[d.pos + 1] == 0x00) {
+            d.pos += 2;
+            return 0xff;
+        }
+        d.atMarker = true;
+        return 0;
+    }
+    ++d.pos;
+    return byte;
+}
+
+static int getBits(Decoder &d, int count)
+{
+    while (d.bitCount < count) {
+        d.bits = (d.bits << 8) | nextByte(d);
+        d.bitCount += 8;
+    }
+    d.bitCount -= count;
+    return (d.bits >> d.bitCount) & ((1u << count) - 1);
+}
+
+// Sign extension of a count bit magnitude, T.81 F.2.2.1
+static inline int extend(int value, int count)
+{
+    return value < (1 << (count - 1)) ? value - (1 << count) + 1 : value;
+}
+
+static int decodeHuffman(Decoder &d, const Huffman &table)
+{
+    int code = 0;
+    for (int length = 1; length <= 16; ++length) {
+        code = (code << 1) | getBits(d, 1);
+        if (code <= table.maxCode[length])
+            return table.values[table.valuePtr[length] + code - table.minCode[length]];
+    }
+    return -1;
+}
+
+static bool readHuffmanTables(Decoder &d, const unsigned char *p, int length)
+{
+    while (length >= 17) {
+        const int tableClass = p[0] >> 4;
+        const int id = p[0] & 0x0f;
+        if (tableClass > 1 || id > 3)
+            return false;
+        Huffman &table = tableClass ? d.ac[id] : d.dc[id];
+
+        int total = 0;
+        int code = 0;
+        for (int i = 1; i <= 16; ++i) {
+            const int count = p[i];
+            table.valuePtr[i] = total;
+            table.minCode[i] = code;
+            code += count;
+            total += count;
+            table.maxCode[i] = count ? code - 1 : -1;
+            code <<= 1;
+        }
+        if (total > 256 || 17 + total > length)
+            return false;
+        memcpy(table.values, p + 17, total);
+        table.defined = true;
+        p += 17 + total;
+        length -= 17 + total;
+    }
+    return length == 0;
+}
+
+static bool readQuantTables(Decoder &d, const unsigned char *p, int length)
+{
+    while (length > 0) {
+        const int precision = p[0] >> 4;
+        const int id = p[0] & 0x0f;
+        const int tableSize = precision ? 129 : 65;
+        if (id > 3 || tableSize > length)
+            return false;
+        for (int i = 0; i < 64; ++i)
+            d.quant[id][i] = precision ? read16(p + 1 + 2 * i) : p[1 + i];
+        p += tableSize;
+        length -= tableSize;
+    }
+    return true;
+}
+
+static bool readFrame(Decoder &d, const unsigned char *p, int length)
+{
+    if (length < 6 || p[0] != 8)
+        return false;
+    d.height = read16(p + 1);
+    d.width = read16(p + 3);
+    d.componentCount = p[5];
+    if (d.width <= 0 || d.height <= 0 || (d.componentCount != 1 && d.componentCount != MAX_COMPONENTS)
+        || length < 6 + 3 * d.componentCount)
+        return false;
+
+    d.hmax = 1;
+    d.vmax = 1;
+    for (int i = 0; i < d.componentCount; ++i) {
+        Component &c = d.components[i];
+        c.id = p[6 + 3 * i];
+        c.h = p[7 + 3 * i] >> 4;
+        c.v = p[7 + 3 * i] & 0x0f;
+        c.quant = p[8 + 3 * i];
+        if (c.h < 1 || c.h > MAX_SAMPLING || c.v < 1 || c.v > MAX_SAMPLING || c.quant > 3)
+            return false;
+        if (c.h > d.hmax)
+            d.hmax = c.h;
+        if (c.v > d.vmax)
+            d.vmax = c.v;
+    }
+    // A single component is not interleaved, its MCU is one block
+    if (d.componentCount == 1)
+        d.components[0].h = d.components[0].v = d.hmax = d.vmax = 1;
+    return true;
+}
+
+// Walks the marker segments up to the start of scan, pos then points at the
+// entropy coded data
+static bool readHeaders(Decoder &d, bool stopAtFrame)
+{
+    if (d.size < 4 || d.data[0] != 0xff || d.data[1] != 0xd8)
+        return false;
+    d.pos = 2;
+
+    bool haveFrame = false;
+    for (;;) {
+        while (d.pos < d.size && d.data[d.pos] != 0xff)
+            ++d.pos;
+        while (d.pos < d.size && d.data[d.pos] == 0xff)
+            ++d.pos;
+        if (d.pos + 2 >= d.size)
+            return false;
+        const int marker = d.data[d.pos++];
+        if (marker == 0xd9)
+            return false;
+        if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd7))
+            continue;
+
+        const int length = read16(d.data + d.pos);
+        if (length < 2 || d.pos + length > d.size)
+            return false;
+        const unsigned char *p = d.data + d.pos + 2;
+        d.pos += length;
+
+        switch (marker) {
+        case 0xc0: // baseline
+        case 0xc1: // extended sequential, 8 bit precision only
+            if (!readFrame(d, p, length - 2))
+                return false;
+            if (stopAtFrame)
+                return true;
+            haveFrame = true;
+            break;
+        case 0xc4:
+            if (!readHuffmanTables(d, p, length - 2))
+                return false;
+            break;
+        case 0xdb:
+            if (!readQuantTables(d, p, length - 2))
+                return false;
+            break;
+        case 0xdd:
+            if (length < 4)
+                return false;
+            d.restartInterval = read16(p);
+            break;
+        case 0xda: {
+            // Only a single scan with all components interleaved
+            if (!haveFrame || length < 3 || p[0] != d.componentCount || length < 6 + 2 * p[0])
+                return false;
+            for (int i = 0; i < d.componentCount; ++i) {
+                Component &c = d.components[i];
+                if (p[1 + 2 * i] != c.id)
+                    return false;
+                c.dcTable = p[2 + 2 * i] >> 4;
+                c.acTable = p[2 + 2 * i] & 0x0f;
+                if (c.dcTable > 3 || c.acTable > 3 || !d.dc[c.dcTable].defined || !d.ac[c.acTable].defined)
+                    return false;
+            }
+            return true;
+        }
+        default:
+            // Progressive, lossless, hierarchical and arithmetic coded frames
+            if (marker >= 0xc2 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc)
+                return false;
+            break;
+        }
+    }
+}
+
+// Dequantized coefficients of one block in natural order
+static bool decodeBlock(Decoder &d, Component &c, int coefficients[64])
+{
+    memset(coefficients, 0, 64 * sizeof(int));
+    const uint16_t *quant = d.quant[c.quant];
+
+    const int dcSize = decodeHuffman(d, d.dc[c.dcTable]);
+    if (dcSize < 0 || dcSize > 11)
+        return false;
+    if (dcSize)
+        c.dcPredictor += extend(getBits(d, dcSize), dcSize);
+    coefficients[0] = c.dcPredictor * quant[0];
+
+    for (int k = 1; k < 64;) {
+        const int symbol = decodeHuffman(d, d.ac[c.acTable]);
+        if (symbol < 0)
+            return false;
+        const int run = symbol >> 4;
+        const int acSize = symbol & 0x0f;
+        if (!acSize) {
+            if (run != 15)
+                break;      // end of block
+            k += 16;
+            continue;
+        }
+        k += run;
+        if (k > 63)
+            return false;
+        coefficients[zigzag[k]] = extend(getBits(d, acSize), acSize) * quant[k];
+        ++k;
+    }
+    return true;
+}
+
+// Separable float IDCT, out gets level shifted samples
+static void inverseDct(const int coefficients[64], uint8_t *out, int stride)
+{
+    static float cosines[8][8];
+    static bool cosinesReady = false;
+    if (!cosinesReady) {
+        for (int x = 0; x < 8; ++x) {
+            for (int u = 0; u < 8; ++u)
+                cosines[x][u] = (u ? 0.5f : 0.5f / std::sqrt(2.0f)) * std::cos((2 * x + 1) * u * 3.14159265f / 16);
+        }
+        cosinesReady = true;
+    }
+
+    float rows[64];
+    for (int v = 0; v < 8; ++v) {
+        for (int x = 0; x < 8; ++x) {
+            float sum = 0;
+            for (int u = 0; u < 8; ++u)
+                sum += cosines[x][u] * coefficients[v * 8 + u];
+            rows[v * 8 + x] = sum;
+        }
+    }
+    for (int x = 0; x < 8; ++x) {
+        for (int y = 0; y < 8; ++y) {
+            float sum = 0;
+            for (int v = 0; v < 8; ++v)
+                sum += cosines[y][v] * rows[v * 8 + x];
+            out[y * stride + x] = clamp255(int(std::floor(sum + 128.5f)));
+        }
+    }
+}
+
+// Reads the RSTn marker the bit reader stopped at
+static bool restart(Decoder &d)
+{
+    d.bits = 0;
+    d.bitCount = 0;
+    d.atMarker = false;
+    if (d.pos + 1 >= d.size || d.data[d.pos] != 0xff || (d.data[d.pos + 1] & 0xf8) != 0xd0)
+        return false;
+    d.pos += 2;
+    for (int i = 0; i < d.componentCount; ++i)
+        d.components[i].dcPredictor = 0;
+    return true;
+}
+
+bool readSize(const unsigned char *data, std::size_t size, int *width, int *height)
+{
+    Decoder &d = decoder;
+    memset(&d, 0, sizeof(d));
+    d.data = data;
+    d.size = size;
+    if (!readHeaders(d, true))
+        return false;
+    *width = d.width;
+    *height = d.height;
+    return true;
+}
+
+bool decode(const unsigned char *data, std::size_t size, unsigned char *bits, int bytesPerLine)
+{
+    Decoder &d = decoder;
+    memset(&d, 0, sizeof(d));
+    d.data = data;
+    d.size = size;
+    if (!readHeaders(d, false))
+        return false;
+
+    const int mcuWidth = 8 * d.hmax;
+    const int mcuHeight = 8 * d.vmax;
+    const int mcusX = (d.width + mcuWidth - 1) / mcuWidth;
+    const int mcusY = (d.height + mcuHeight - 1) / mcuHeight;
+
+    // Samples of one MCU per component, blocks placed at their position
+    uint8_t samples[MAX_COMPONENTS][8 * MAX_SAMPLING * 8 * MAX_SAMPLING];
+    const int sampleStride = 8 * MAX_SAMPLING;
+    int coefficients[64];
+    int mcusToRestart = d.restartInterval;
+
+    for (int mcuY = 0; mcuY < mcusY; ++mcuY) {
+        for (int mcuX = 0; mcuX < mcusX; ++mcuX) {
+            if (d.restartInterval) {
+                if (!mcusToRestart) {
+                    if (!restart(d))
+                        return false;
+                    mcusToRestart = d.restartInterval;
+                }
+                --mcusToRestart;
+            }
+
+            for (int i = 0; i < d.componentCount; ++i) {
+                Component &c = d.components[i];
+                for (int by = 0; by < c.v; ++by) {
+                    for (int bx = 0; bx < c.h; ++bx) {
+                        if (!decodeBlock(d, c, coefficients))
+                            return false;
+                        inverseDct(coefficients, samples[i] + by * 8 * sampleStride + bx * 8, sampleStride);
+                    }
+                }
+            }
+
+            const int x0 = mcuX * mcuWidth;
+            const int y0 = mcuY * mcuHeight;
+            for (int y = 0; y < mcuHeight && y0 + y < d.height; ++y) {
+                uint32_t *line = reinterpret_cast<uint32_t *>(bits + (y0 + y) * bytesPerLine) + x0;
+                for (int x = 0; x < mcuWidth && x0 + x < d.width; ++x) {
+                    int sample[MAX_COMPONENTS];
+                    // Nearest neighbour upsampling of subsampled components
+                    for (int i = 0; i < d.componentCount; ++i) {
+                        const Component &c = d.components[i];
+                        sample[i] = samples[i][(y * c.v / d.vmax) * sampleStride + x * c.h / d.hmax];
+                    }
+
+                    int r, g, b;
+                    if (d.componentCount == 1) {
+                        r = g = b = sample[0];
+                    } else {
+                        // JFIF YCbCr, 16.16 fixed point
+                        const int cb = sample[1] - 128;
+                        const int cr = sample[2] - 128;
+                        r = clamp255(sample[0] + ((91881 * cr + 32768) >> 16));
+                        g = clamp255(sample[0] - ((22554 * cb + 46802 * cr - 32768) >> 16));
+                        b = clamp255(sample[0] + ((116130 * cb + 32768) >> 16));
+                    }
+                    line[x] = 0xff000000u | (r << 16) | (g << 8) | b;
+                }
+            }
+        }
+    }
+    // Without an EOI marker after it the stream was cut short
+    return !d.truncated;
+}
+
+} // namespace SoftJpeg
+} // namespace Platform
+} // namespace Qul
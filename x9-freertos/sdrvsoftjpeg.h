@@ -0,0 +1,48 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVSOFTJPEG_H
+#define SDRVSOFTJPEG_H
+
+#include <cstddef>
+
+namespace Qul {
+namespace Platform {
+namespace SoftJpeg {
+
+/*
+ * Software stand-in for the JPU, used by builds without the CODA J12 and by
+ * host tests. Handles baseline (sequential, Huffman coded, 8 bit) grayscale
+ * and YCbCr streams with any 1x1 to 2x2 chroma subsampling and restart
+ * markers; progressive and arithmetic coded streams are rejected.
+ */
+
+// Picture size from the frame header, false if there is none or it is unsupported
+bool readSize(const unsigned char *data, std::size_t size, int *width, int *height);
+
+// Decodes into bits as PixelFormat_RGB32 (0xffRRGGBB words), width * height
+// as reported by readSize(). Returns false on corrupt or unsupported streams.
+bool decode(const unsigned char *data, std::size_t size, unsigned char *bits, int bytesPerLine);
+
+} // namespace SoftJpeg
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVSOFTJPEG_H
@@ -0,0 +1,84 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVSPSCQUEUE_H
+#define SDRVSPSCQUEUE_H
+
+#include <cstdint>
+
+namespace Qul {
+namespace Platform {
+
+/*
+ * Bounded lock-free queue between exactly one producer and one consumer,
+ * each of which may be a task or an interrupt handler. Items are copied in
+ * and out, Capacity must be a power of two. Head and tail run freely and
+ * wrap, only the producer writes the tail and only the consumer the head.
+ */
+template<typename T, uint32_t Capacity>
+class SDRVSpscQueue
+{
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SDRVSpscQueue()
+        : m_head(0)
+        , m_tail(0)
+    {}
+
+    // Producer side, false when the queue is full
+    bool push(const T &item)
+    {
+        const uint32_t tail = m_tail;
+        if (tail - __atomic_load_n(&m_head, __ATOMIC_ACQUIRE) == Capacity)
+            return false;
+        m_items[tail & (Capacity - 1)] = item;
+        __atomic_store_n(&m_tail, tail + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Consumer side, false when the queue is empty
+    bool pop(T &item)
+    {
+        const uint32_t head = m_head;
+        if (__atomic_load_n(&m_tail, __ATOMIC_ACQUIRE) == head)
+            return false;
+        item = m_items[head & (Capacity - 1)];
+        __atomic_store_n(&m_head, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Either side, only a snapshot while the other side runs
+    uint32_t size() const
+    {
+        return __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE) - __atomic_load_n(&m_head, __ATOMIC_ACQUIRE);
+    }
+    bool isEmpty() const { return size() == 0; }
+
+private:
+    T m_items[Capacity];
+    uint32_t m_head;
+    uint32_t m_tail;
+};
+
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVSPSCQUEUE_H
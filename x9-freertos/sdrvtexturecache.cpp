@@ -0,0 +1,254 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvtexturecache.h"
+#include "sdrvallocator.h"
+#include "sdrvassetpreload.h"
+#include "sdrvdma.h"
+
+#include <lk_wrapper.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace Qul {
+namespace Platform {
+namespace TextureCache {
+
+#define MAX_ENTRIES 64
+
+struct Entry
+{
+    const unsigned char *flash;   /* source data, NULL marks a free entry */
+    unsigned char *ram;           /* NULL until promoted */
+    std::size_t size;
+    std::size_t srcSize;          /* compressed size, for decoded entries */
+    uint32_t draws;
+    uint32_t lastUse;
+    uint32_t pins;
+    int transfer;                 /* DMA transfer id while copying, otherwise -1 */
+};
+
+static Entry entries[MAX_ENTRIES];
+static std::size_t usedBytes = 0;
+static uint32_t useCounter = 0;
+static uint32_t hits = 0;
+static uint32_t misses = 0;
+static uint32_t evictions = 0;
+
+static Entry *find(const unsigned char *data)
+{
+    for (int i = 0; i < MAX_ENTRIES; ++i) {
+        if (entries[i].flash == data)
+            return &entries[i];
+    }
+    return NULL;
+}
+
+static void dropRam(Entry &entry)
+{
+    Allocator::release(entry.ram);
+    entry.ram = NULL;
+    entry.draws = 0;
+    usedBytes -= entry.size;
+    ++evictions;
+}
+
+// Free entry for data, recycling the least recently used unpromoted one
+static Entry *insert(const unsigned char *data, std::size_t size, std::size_t srcSize)
+{
+    Entry *victim = NULL;
+    for (int i = 0; i < MAX_ENTRIES; ++i) {
+        Entry &entry = entries[i];
+        if (!entry.flash) {
+            victim = &entry;
+            break;
+        }
+        if (!entry.ram && (!victim || entry.lastUse < victim->lastUse))
+            victim = &entry;
+    }
+    if (!victim)
+        return NULL;
+
+    victim->flash = data;
+    victim->ram = NULL;
+    victim->size = size;
+    victim->srcSize = srcSize;
+    victim->draws = 0;
+    victim->pins = 0;
+    victim->transfer = -1;
+    return victim;
+}
+
+// Finishes the copies whose DMA completed, so that their transfer slot is
+// free again and the copy can be evicted, even if it is never drawn again
+static void reapTransfers()
+{
+    for (int i = 0; i < MAX_ENTRIES; ++i) {
+        Entry &entry = entries[i];
+        if (entry.flash && entry.transfer >= 0 && dmaTransferDone(entry.transfer))
+            entry.transfer = -1;
+    }
+}
+
+// Evicts least recently used copies until size more bytes fit the budget
+static bool makeRoom(std::size_t size)
+{
+    if (size > SDRV_TEXTURE_CACHE_BUDGET)
+        return false;
+
+    reapTransfers();
+    while (usedBytes + size > SDRV_TEXTURE_CACHE_BUDGET) {
+        Entry *victim = NULL;
+        for (int i = 0; i < MAX_ENTRIES; ++i) {
+            Entry &entry = entries[i];
+            if (entry.ram && !entry.pins && entry.transfer < 0 && (!victim || entry.lastUse < victim->lastUse))
+                victim = &entry;
+        }
+        if (!victim)
+            return false;
+        dropRam(*victim);
+    }
+    return true;
+}
+
+static bool promote(Entry &entry, bool wait, Decoder decode)
+{
+    if (!makeRoom(entry.size))
+        return false;
+
+    entry.ram = (unsigned char *)Allocator::allocate(entry.size, Allocator::Memory_G2DScratch);
+    if (!entry.ram)
+        return false;
+    usedBytes += entry.size;
+
+    if (decode) {
+        if (!decode(entry.flash, entry.srcSize, entry.ram, entry.size)) {
+            printf("TextureCache cannot decode texture %p\n", entry.flash);
+            Allocator::release(entry.ram);
+            entry.ram = NULL;
+            usedBytes -= entry.size;
+            return false;
+        }
+        arch_clean_cache_range((addr_t)entry.ram, entry.size);
+        entry.transfer = -1;
+        return true;
+    }
+
+    entry.transfer = wait ? -1 : dmaCopyAsync(entry.ram, entry.flash, entry.size);
+    if (entry.transfer < 0)
+        dmaCopy(entry.ram, entry.flash, entry.size);
+    return true;
+}
+
+// RAM copy if it is complete, otherwise NULL
+static const unsigned char *ready(Entry &entry)
+{
+    if (!entry.ram)
+        return NULL;
+    if (entry.transfer >= 0) {
+        if (!dmaTransferDone(entry.transfer))
+            return NULL;
+        entry.transfer = -1;
+    }
+    return entry.ram;
+}
+
+const unsigned char *lookup(const unsigned char *data, std::size_t size, Decoder decode, std::size_t srcSize)
+{
+    if (!data || (!decode && !isKeepInFlashAsset(data)))
+        return data;
+
+    reapTransfers();
+    Entry *entry = find(data);
+    if (!entry) {
+        entry = insert(data, size, srcSize);
+        if (!entry) {
+            ++misses;
+            return decode ? NULL : data;
+        }
+    }
+    entry->lastUse = ++useCounter;
+
+    const unsigned char *ram = ready(*entry);
+    if (ram) {
+        ++hits;
+        return ram;
+    }
+
+    ++misses;
+    // Compressed data cannot be drawn as is, decode it right away
+    if (decode)
+        return promote(*entry, true, decode) ? entry->ram : NULL;
+
+    // The copy runs in the background, this draw still reads the flash
+    if (!entry->ram && ++entry->draws >= SDRV_TEXTURE_CACHE_PROMOTE_DRAWS)
+        promote(*entry, false, NULL);
+    return data;
+}
+
+const unsigned char *pin(const unsigned char *data, std::size_t size, Decoder decode, std::size_t srcSize)
+{
+    if (!data || (!decode && !isKeepInFlashAsset(data)))
+        return data;
+
+    Entry *entry = find(data);
+    if (!entry)
+        entry = insert(data, size, srcSize);
+    if (!entry)
+        return decode ? NULL : data;
+    entry->lastUse = ++useCounter;
+
+    if (!entry->ram && !promote(*entry, true, decode))
+        return decode ? NULL : data;
+    if (entry->transfer >= 0) {
+        dmaWait(entry->transfer);
+        entry->transfer = -1;
+    }
+    ++entry->pins;
+    return entry->ram;
+}
+
+void unpin(const unsigned char *data)
+{
+    Entry *entry = data ? find(data) : NULL;
+    if (entry && entry->pins)
+        --entry->pins;
+}
+
+void printStats()
+{
+    int cached = 0;
+    for (int i = 0; i < MAX_ENTRIES; ++i) {
+        if (entries[i].ram)
+            ++cached;
+    }
+    printf("texture cache: %d textures, %u of %u bytes, %u hits, %u misses, %u evictions\n",
+           cached,
+           (unsigned)usedBytes,
+           (unsigned)SDRV_TEXTURE_CACHE_BUDGET,
+           (unsigned)hits,
+           (unsigned)misses,
+           (unsigned)evictions);
+}
+
+} // namespace TextureCache
+} // namespace Platform
+} // namespace Qul
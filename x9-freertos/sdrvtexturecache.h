@@ -0,0 +1,73 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVTEXTURECACHE_H
+#define SDRVTEXTURECACHE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// RAM budget for copies of flash-resident textures
+#ifndef SDRV_TEXTURE_CACHE_BUDGET
+#define SDRV_TEXTURE_CACHE_BUDGET (4 * 1024 * 1024)
+#endif
+
+// A flash texture is copied to RAM once it has been drawn this many times
+#ifndef SDRV_TEXTURE_CACHE_PROMOTE_DRAWS
+#define SDRV_TEXTURE_CACHE_PROMOTE_DRAWS 2
+#endif
+
+namespace Qul {
+namespace Platform {
+namespace TextureCache {
+
+// Expands srcSize bytes of compressed texture data to size bytes of pixels,
+// false if the data is corrupt or ends early
+typedef bool (*Decoder)(const unsigned char *src, std::size_t srcSize, unsigned char *dst, std::size_t size);
+
+/*
+ * Returns the address to read the texture data from. Data outside of
+ * AssetDataKeepInFlash is returned as is. Flash data is returned as is until
+ * it has been drawn often enough to be copied to RAM with DMA, afterwards the
+ * RAM copy is returned until it is evicted as least recently used.
+ *
+ * With a decoder, data is srcSize bytes of compressed data and size is its
+ * decoded size. It is decoded to RAM on first use wherever it is stored, and
+ * NULL is returned when the decoded texture does not fit in the budget or the
+ * data cannot be decoded.
+ */
+const unsigned char *lookup(const unsigned char *data, std::size_t size, Decoder decode = NULL,
+                            std::size_t srcSize = 0);
+
+/*
+ * Same as lookup(), but copies flash data to RAM right away and keeps the copy
+ * from being evicted until unpin(), for buffers scanned out by DC.
+ */
+const unsigned char *pin(const unsigned char *data, std::size_t size, Decoder decode = NULL,
+                         std::size_t srcSize = 0);
+void unpin(const unsigned char *data);
+
+void printStats();
+
+} // namespace TextureCache
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVTEXTURECACHE_H
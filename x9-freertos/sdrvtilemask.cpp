@@ -0,0 +1,152 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvtilemask.h"
+
+#include <lk_wrapper.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace Qul {
+namespace Platform {
+
+SDRVTileMask::SDRVTileMask()
+    : m_width(0)
+    , m_height(0)
+    , m_tilesX(0)
+    , m_tilesY(0)
+{
+    clear();
+}
+
+void SDRVTileMask::reset(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+    m_tilesX = std::min((width + SDRV_TILE_SIZE - 1) / SDRV_TILE_SIZE, 64);
+    m_tilesY = std::min((height + SDRV_TILE_SIZE - 1) / SDRV_TILE_SIZE, int(MaxRows));
+    clear();
+}
+
+void SDRVTileMask::clear()
+{
+    memset(m_rows, 0, sizeof(m_rows));
+}
+
+bool SDRVTileMask::isEmpty() const
+{
+    for (int ty = 0; ty < m_tilesY; ++ty) {
+        if (m_rows[ty])
+            return false;
+    }
+    return true;
+}
+
+void SDRVTileMask::markRect(const PlatformInterface::Rect &rect)
+{
+    if (rect.isEmpty())
+        return;
+
+    const int tx0 = std::max(rect.x() / SDRV_TILE_SIZE, 0);
+    const int ty0 = std::max(rect.y() / SDRV_TILE_SIZE, 0);
+    const int tx1 = std::min((rect.x() + rect.width() - 1) / SDRV_TILE_SIZE, m_tilesX - 1);
+    const int ty1 = std::min((rect.y() + rect.height() - 1) / SDRV_TILE_SIZE, m_tilesY - 1);
+    if (tx0 > tx1)
+        return;
+
+    const uint64_t bits = (~uint64_t(0) >> (63 - (tx1 - tx0))) << tx0;
+    for (int ty = ty0; ty <= ty1; ++ty)
+        m_rows[ty] |= bits;
+}
+
+void SDRVTileMask::merge(const SDRVTileMask &other)
+{
+    for (int ty = 0; ty < m_tilesY; ++ty)
+        m_rows[ty] |= other.m_rows[ty];
+}
+
+void SDRVTileMask::subtractRect(const PlatformInterface::Rect &rect)
+{
+    if (rect.isEmpty())
+        return;
+
+    // Only tiles inside rect, or cut off by the buffer edge, are covered
+    const int right = rect.x() + rect.width();
+    const int bottom = rect.y() + rect.height();
+    const int tx0 = std::max((rect.x() + SDRV_TILE_SIZE - 1) / SDRV_TILE_SIZE, 0);
+    const int ty0 = std::max((rect.y() + SDRV_TILE_SIZE - 1) / SDRV_TILE_SIZE, 0);
+    const int tx1 = std::min((right >= m_width ? m_tilesX * SDRV_TILE_SIZE : right) / SDRV_TILE_SIZE, m_tilesX) - 1;
+    const int ty1 = std::min((bottom >= m_height ? m_tilesY * SDRV_TILE_SIZE : bottom) / SDRV_TILE_SIZE, m_tilesY) - 1;
+    if (tx0 > tx1)
+        return;
+
+    const uint64_t bits = (~uint64_t(0) >> (63 - (tx1 - tx0))) << tx0;
+    for (int ty = ty0; ty <= ty1; ++ty)
+        m_rows[ty] &= ~bits;
+}
+
+void SDRVTileMask::forEachRun(RectCallback callback, void *userData) const
+{
+    for (int ty = 0; ty < m_tilesY; ++ty) {
+        const uint64_t row = m_rows[ty];
+        const int y = ty * SDRV_TILE_SIZE;
+        const int h = std::min(SDRV_TILE_SIZE, m_height - y);
+        int tx = 0;
+        while (row >> tx) {
+            if (!((row >> tx) & 1)) {
+                ++tx;
+                continue;
+            }
+            const int start = tx;
+            while (tx < m_tilesX && ((row >> tx) & 1))
+                ++tx;
+            const int x = start * SDRV_TILE_SIZE;
+            const int w = std::min((tx - start) * SDRV_TILE_SIZE, m_width - x);
+            callback(PlatformInterface::Rect(x, y, w, h), userData);
+            if (tx >= 64)
+                break;
+        }
+    }
+}
+
+struct CleanTarget
+{
+    unsigned char *bits;
+    int bytesPerLine;
+    int bytesPerPixel;
+};
+
+static void cleanRect(const PlatformInterface::Rect &rect, void *userData)
+{
+    const CleanTarget &target = *static_cast<const CleanTarget *>(userData);
+    unsigned char *line = target.bits + rect.y() * target.bytesPerLine + rect.x() * target.bytesPerPixel;
+    for (int i = 0; i < rect.height(); ++i, line += target.bytesPerLine)
+        arch_clean_cache_range((addr_t)line, rect.width() * target.bytesPerPixel);
+}
+
+void SDRVTileMask::cleanCache(unsigned char *bits, int bytesPerLine, int bytesPerPixel) const
+{
+    CleanTarget target = {bits, bytesPerLine, bytesPerPixel};
+    forEachRun(cleanRect, &target);
+}
+
+} // namespace Platform
+} // namespace Qul
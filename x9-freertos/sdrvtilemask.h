@@ -0,0 +1,77 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVTILEMASK_H
+#define SDRVTILEMASK_H
+
+#include <platforminterface/rect.h>
+
+#include <cstdint>
+
+// Tile edge in pixels, a 32bpp tile is 16 KB and fits the R5 data cache
+#ifndef SDRV_TILE_SIZE
+#define SDRV_TILE_SIZE 64
+#endif
+
+namespace Qul {
+namespace Platform {
+
+/*
+ * One bit per SDRV_TILE_SIZE square of a buffer, used to track what the CPU
+ * or a frame touched so that only those tiles are cleaned from the cache or
+ * copied forward between double buffers. Buffers up to 64 tiles wide and
+ * MaxRows tiles high are supported, larger ones are clamped.
+ */
+class SDRVTileMask
+{
+public:
+    typedef void (*RectCallback)(const PlatformInterface::Rect &rect, void *userData);
+
+    SDRVTileMask();
+
+    void reset(int width, int height);
+    void clear();
+    bool isEmpty() const;
+
+    void markRect(const PlatformInterface::Rect &rect);
+    void merge(const SDRVTileMask &other);
+    /* Drops the tiles rect covers completely */
+    void subtractRect(const PlatformInterface::Rect &rect);
+
+    /* Calls back once per horizontal run of marked tiles, clipped to the buffer */
+    void forEachRun(RectCallback callback, void *userData) const;
+
+    /* Cleans the marked tiles of a buffer from the data cache */
+    void cleanCache(unsigned char *bits, int bytesPerLine, int bytesPerPixel) const;
+
+private:
+    enum { MaxRows = 64 };
+
+    uint64_t m_rows[MaxRows];
+    int m_width;
+    int m_height;
+    int m_tilesX;
+    int m_tilesY;
+};
+
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVTILEMASK_H
@@ -0,0 +1,140 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvtouch.h"
+
+#include <platform/singlepointtoucheventdispatcher.h>
+
+#include "sdrvscreens.h"
+
+#ifndef SDRV_TOUCH_PREDICTION_MAX_US
+#define SDRV_TOUCH_PREDICTION_MAX_US 16000
+#endif
+
+namespace Qul {
+namespace Platform {
+namespace Touch {
+
+// Samples closer than this are averaged into the next velocity update
+#define MIN_VELOCITY_INTERVAL_US 2000
+// A finger that did not move for this long is at rest
+#define AT_REST_US 50000
+
+struct ScreenTouch
+{
+    int x;
+    int y;
+    bool pressed;
+    bool isMove;
+    uint64_t timestampUs;
+
+    // Position and time the velocity was last updated at
+    int velocityX;
+    int velocityY;
+    uint64_t velocityUs;
+    float vx; // pixels per microsecond
+    float vy;
+};
+
+static ScreenTouch touches[SDRV_MAX_SCREENS];
+
+static SinglePointTouchEventDispatcher touchDispatchers[SDRV_MAX_SCREENS] = {
+    SinglePointTouchEventDispatcher(&Screens::all()[0]),
+    SinglePointTouchEventDispatcher(&Screens::all()[1]),
+};
+
+void addSample(int screen, int x, int y, bool pressed, uint64_t timestampUs)
+{
+    if (screen < 0 || screen >= SDRV_MAX_SCREENS)
+        return;
+
+    ScreenTouch &touch = touches[screen];
+    touch.isMove = pressed && touch.pressed;
+    touch.x = x;
+    touch.y = y;
+    touch.pressed = pressed;
+    touch.timestampUs = timestampUs;
+
+    if (!touch.isMove) {
+        touch.velocityX = x;
+        touch.velocityY = y;
+        touch.velocityUs = timestampUs;
+        touch.vx = 0.f;
+        touch.vy = 0.f;
+        return;
+    }
+
+    const uint64_t dt = timestampUs - touch.velocityUs;
+    if (dt < MIN_VELOCITY_INTERVAL_US)
+        return;
+
+    // Exponential average, a single noisy sample only moves it halfway
+    const float sx = float(x - touch.velocityX) / float(dt);
+    const float sy = float(y - touch.velocityY) / float(dt);
+    touch.vx = dt > AT_REST_US ? sx : (touch.vx + sx) * 0.5f;
+    touch.vy = dt > AT_REST_US ? sy : (touch.vy + sy) * 0.5f;
+    touch.velocityX = x;
+    touch.velocityY = y;
+    touch.velocityUs = timestampUs;
+}
+
+#if SDRV_TOUCH_PREDICTION
+static int clampTo(int value, int size)
+{
+    return value < 0 ? 0 : value >= size ? size - 1 : value;
+}
+
+static void predict(int screen, const ScreenTouch &touch, uint64_t presentUs, SinglePointTouchEvent &event)
+{
+    if (!touch.isMove || presentUs <= touch.timestampUs || touch.timestampUs - touch.velocityUs > AT_REST_US)
+        return;
+
+    uint64_t horizon = presentUs - touch.timestampUs;
+    if (horizon > SDRV_TOUCH_PREDICTION_MAX_US)
+        horizon = SDRV_TOUCH_PREDICTION_MAX_US;
+
+    const PlatformInterface::Size size = Screens::all()[screen].size();
+    event.x = clampTo(touch.x + int(touch.vx * float(horizon)), size.width());
+    event.y = clampTo(touch.y + int(touch.vy * float(horizon)), size.height());
+}
+#endif
+
+void dispatch(int screen, uint64_t presentUs)
+{
+    if (screen < 0 || screen >= SDRV_MAX_SCREENS)
+        return;
+
+    const ScreenTouch &touch = touches[screen];
+    SinglePointTouchEvent event;
+    event.x = touch.x;
+    event.y = touch.y;
+    event.pressed = touch.pressed;
+    event.timestamp = touch.timestampUs / 1000;
+#if SDRV_TOUCH_PREDICTION
+    predict(screen, touch, presentUs, event);
+#else
+    (void) presentUs;
+#endif
+    touchDispatchers[screen].dispatch(event);
+}
+
+} // namespace Touch
+} // namespace Platform
+} // namespace Qul
@@ -0,0 +1,53 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVTOUCH_H
+#define SDRVTOUCH_H
+
+#include <cstdint>
+
+namespace Qul {
+namespace Platform {
+namespace Touch {
+
+/*
+ * Touch state of each screen on the engine task side of the input ring.
+ * Every sample feeds the screen's motion estimate, including moves the ring
+ * coalesced away, so the velocity stays accurate at any sample rate. Only
+ * the samples left after coalescing are dispatched to Qul.
+ *
+ * With SDRV_TOUCH_PREDICTION, a dispatched move is extrapolated along the
+ * estimated velocity to the predicted vsync the frame is shown at, at most
+ * SDRV_TOUCH_PREDICTION_MAX_US ahead of the sample. Presses and releases
+ * are dispatched where they were sampled.
+ */
+
+// Engine task only, timestampUs on the clockUs() timebase
+void addSample(int screen, int x, int y, bool pressed, uint64_t timestampUs);
+
+// Dispatches the last sample added for the screen, presentUs is the
+// predicted vsync of that screen the frame is shown at
+void dispatch(int screen, uint64_t presentUs);
+
+} // namespace Touch
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVTOUCH_H
@@ -0,0 +1,96 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvwakeup.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+// Interrupt nesting depth maintained by the Cortex-R5 port
+extern "C" volatile uint32_t ulPortInterruptNesting;
+
+namespace Qul {
+namespace Platform {
+
+static TaskHandle_t engineTask = NULL;
+static volatile uint32_t pendingReasons = 0;
+
+void initEngineWakeup()
+{
+    engineTask = xTaskGetCurrentTaskHandle();
+}
+
+static TickType_t toTicks(uint64_t timeoutMs)
+{
+    // Timeouts beyond the tick range mean "until signaled"
+    if (timeoutMs >= uint64_t(portMAX_DELAY / 2) * portTICK_PERIOD_MS)
+        return portMAX_DELAY;
+    const TickType_t ticks = pdMS_TO_TICKS(timeoutMs);
+    return ticks ? ticks : 1;
+}
+
+uint32_t waitForEngineWakeup(uint32_t reasons, uint64_t timeoutMs)
+{
+    const TickType_t timeout = toTicks(timeoutMs);
+    const TickType_t start = xTaskGetTickCount();
+
+    while (true) {
+        const uint32_t fired = __atomic_fetch_and(&pendingReasons, ~reasons, __ATOMIC_ACQ_REL) & reasons;
+        if (fired)
+            return fired;
+
+        TickType_t remaining = portMAX_DELAY;
+        if (timeout != portMAX_DELAY) {
+            const TickType_t elapsed = xTaskGetTickCount() - start;
+            if (elapsed >= timeout)
+                return 0;
+            remaining = timeout - elapsed;
+        }
+
+        // A notification for a reason we do not wait for just loops around
+        ulTaskNotifyTake(pdTRUE, remaining);
+    }
+}
+
+void signalEngineWakeup(uint32_t reason)
+{
+    if (ulPortInterruptNesting != 0) {
+        signalEngineWakeupFromISR(reason);
+        return;
+    }
+
+    __atomic_fetch_or(&pendingReasons, reason, __ATOMIC_ACQ_REL);
+    if (engineTask)
+        xTaskNotifyGive(engineTask);
+}
+
+void signalEngineWakeupFromISR(uint32_t reason)
+{
+    __atomic_fetch_or(&pendingReasons, reason, __ATOMIC_ACQ_REL);
+    if (!engineTask)
+        return;
+
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(engineTask, &higherPriorityTaskWoken);
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+} // namespace Platform
+} // namespace Qul
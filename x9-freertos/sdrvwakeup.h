@@ -0,0 +1,63 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef SDRVWAKEUP_H
+#define SDRVWAKEUP_H
+
+#include <cstdint>
+
+namespace Qul {
+namespace Platform {
+
+/*
+ * The engine task blocks on a single wait object between engine updates.
+ * Anything that may require an engine update (scheduleEngineUpdate, input,
+ * vsync, G2D or DMA completion, a compositor task done with a frame) signals
+ * it with a reason. A reason signaled before the engine task waits for it is
+ * kept pending, so no wakeup is ever lost.
+ */
+enum WakeupReason {
+    Wakeup_EngineUpdate = 0x1,
+    Wakeup_Input        = 0x2,
+    Wakeup_Vsync        = 0x4,
+    Wakeup_G2D          = 0x8,
+    Wakeup_Dma          = 0x10,
+    Wakeup_Compositor   = 0x20,
+    Wakeup_All          = 0x3f
+};
+
+/* Must be called from the engine task before waiting */
+void initEngineWakeup();
+
+/*
+ * Block the engine task until one of reasons is signaled or timeoutMs has
+ * elapsed. Returns the signaled reasons out of the requested ones, which are
+ * cleared, or 0 on timeout. Other pending reasons stay pending.
+ */
+uint32_t waitForEngineWakeup(uint32_t reasons, uint64_t timeoutMs);
+
+/* Safe from both task and interrupt context */
+void signalEngineWakeup(uint32_t reason);
+void signalEngineWakeupFromISR(uint32_t reason);
+
+} // namespace Platform
+} // namespace Qul
+
+#endif // SDRVWAKEUP_H
@@ -0,0 +1,32 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef HOST_CONFIG_H
+#define HOST_CONFIG_H
+
+#include <lk_wrapper.h>
+
+// External DDR is a static array of the host heap, see hostsdk.h
+extern unsigned char hostExternalMemory[];
+#define EXT_MEM_BASE ((addr_t)hostExternalMemory)
+#define EXT_MEM_SIZE HOST_EXTERNAL_MEMORY_SIZE
+#define HOST_EXTERNAL_MEMORY_SIZE 0x2000000
+
+#endif // HOST_CONFIG_H
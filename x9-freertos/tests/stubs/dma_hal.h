@@ -0,0 +1,55 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef HOST_DMA_HAL_H
+#define HOST_DMA_HAL_H
+
+// Host stand-in for the SDK DMA HAL, backed by the software DMA model in
+// hostdma.cpp, see hostsdk.h for its controls
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum dma_chan_tr_type { DMA_MEM = 0, DMA_PERI };
+enum dma_status { DMA_COMP = 0, DMA_IN_PROGRESS, DMA_PAUSED, DMA_ERR, DMA_PENDING };
+
+#define DMA_INTERRUPT 1
+
+struct dma_chan;
+
+struct dma_desc
+{
+    void *context;
+    void (*dmac_irq_evt_handle)(enum dma_status status, uint32_t param, void *context);
+
+    // Model state
+    void *dst;
+    const void *src;
+    size_t len;
+    enum dma_status status;
+};
+
+struct dma_chan *hal_dma_chan_req(enum dma_chan_tr_type type);
+struct dma_desc *hal_prep_dma_memcpy(struct dma_chan *chan, void *dst, void *src, size_t len, unsigned long flags);
+void hal_dma_submit(struct dma_desc *desc);
+enum dma_status hal_dma_sync_wait(struct dma_desc *desc, int timeout);
+void hal_dma_free_desc(struct dma_desc *desc);
+
+#endif // HOST_DMA_HAL_H
@@ -0,0 +1,39 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef HOST_HEAP_H
+#define HOST_HEAP_H
+
+// Host stand-in for the SDK heap: malloc(align, size) and efree()
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void *hostHeapAllocate(size_t align, size_t size);
+void efree(void *ptr);
+#ifdef __cplusplus
+}
+#endif
+
+#define malloc(align, size) hostHeapAllocate(align, size)
+
+#endif // HOST_HEAP_H
@@ -0,0 +1,167 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "hostsdk.h"
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <dma_hal.h>
+
+#include <cstring>
+#include <deque>
+
+// Interrupt nesting depth, raised while a completion handler runs
+extern "C" {
+volatile uint32_t ulPortInterruptNesting = 0;
+}
+
+static std::deque<dma_desc *> queue;
+static std::size_t descriptorsInUse = 0;
+static bool failNext = false;
+static unsigned stallTicks = 0;
+static TickType_t ticks = 0;
+static uint32_t notifications = 0;
+static int hostTask = 0;
+
+void hostDmaFailNext()
+{
+    failNext = true;
+}
+
+void hostDmaStall(unsigned stall)
+{
+    stallTicks = stall;
+}
+
+size_t hostDmaPendingDescriptors()
+{
+    return queue.size();
+}
+
+size_t hostDmaDescriptorsInUse()
+{
+    return descriptorsInUse;
+}
+
+unsigned hostTicks()
+{
+    return ticks;
+}
+
+// One tick of the channel, returns false if it had nothing to do
+static bool runChannel()
+{
+    ++ticks;
+    if (stallTicks) {
+        --stallTicks;
+        return false;
+    }
+    if (queue.empty())
+        return false;
+
+    dma_desc *desc = queue.front();
+    queue.pop_front();
+    if (failNext) {
+        desc->status = DMA_ERR;
+        failNext = false;
+    } else {
+        std::memcpy(desc->dst, desc->src, desc->len);
+        desc->status = DMA_COMP;
+    }
+    if (desc->dmac_irq_evt_handle) {
+        ++ulPortInterruptNesting;
+        desc->dmac_irq_evt_handle(desc->status, 0, desc->context);
+        --ulPortInterruptNesting;
+    }
+    return true;
+}
+
+struct dma_chan *hal_dma_chan_req(enum dma_chan_tr_type)
+{
+    static int channel;
+    return reinterpret_cast<struct dma_chan *>(&channel);
+}
+
+struct dma_desc *hal_prep_dma_memcpy(struct dma_chan *, void *dst, void *src, size_t len, unsigned long)
+{
+    dma_desc *desc = new dma_desc();
+    desc->dst = dst;
+    desc->src = src;
+    desc->len = len;
+    desc->status = DMA_PENDING;
+    ++descriptorsInUse;
+    return desc;
+}
+
+void hal_dma_submit(struct dma_desc *desc)
+{
+    desc->status = DMA_IN_PROGRESS;
+    queue.push_back(desc);
+}
+
+enum dma_status hal_dma_sync_wait(struct dma_desc *desc, int)
+{
+    while (desc->status == DMA_IN_PROGRESS)
+        runChannel();
+    return desc->status;
+}
+
+void hal_dma_free_desc(struct dma_desc *desc)
+{
+    --descriptorsInUse;
+    delete desc;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return &hostTask;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return ticks;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+    // Blocking lets the hardware run until a notification arrives
+    for (TickType_t waited = 0; !notifications && waited < ticksToWait; ++waited)
+        runChannel();
+
+    const uint32_t count = notifications;
+    if (clearCountOnExit)
+        notifications = 0;
+    else if (notifications)
+        --notifications;
+    return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t)
+{
+    ++notifications;
+    return pdTRUE;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *higherPriorityTaskWoken)
+{
+    ++notifications;
+    if (higherPriorityTaskWoken)
+        *higherPriorityTaskWoken = pdTRUE;
+}
@@ -0,0 +1,119 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "hostsdk.h"
+
+#include <cstdlib>
+#include <map>
+
+// After the C library, heap.h turns malloc into the two argument SDK call
+#include <config.h>
+#include <heap.h>
+
+unsigned char hostExternalMemory[HOST_EXTERNAL_MEMORY_SIZE] __attribute__((aligned(0x1000)));
+
+static HostMemory currentMemory = HostMemory_External;
+// Free ranges of external memory by offset, adjacent ranges are merged
+static std::map<std::size_t, std::size_t> externalFree;
+static bool externalInitialized = false;
+static std::map<void *, std::size_t> blocks;
+static std::size_t bytesInUse = 0;
+
+void hostHeapSetMemory(HostMemory memory)
+{
+    currentMemory = memory;
+}
+
+size_t hostHeapBytesInUse()
+{
+    return bytesInUse;
+}
+
+// First fit, the aligned block is cut out of a free range
+static void *externalAllocate(std::size_t align, std::size_t size)
+{
+    if (!externalInitialized) {
+        externalFree[0] = HOST_EXTERNAL_MEMORY_SIZE;
+        externalInitialized = true;
+    }
+    for (std::map<std::size_t, std::size_t>::iterator it = externalFree.begin(); it != externalFree.end(); ++it) {
+        const std::size_t begin = it->first;
+        const std::size_t end = begin + it->second;
+        const std::size_t offset = (begin + align - 1) & ~(align - 1);
+        if (offset + size > end)
+            continue;
+        externalFree.erase(it);
+        if (offset > begin)
+            externalFree[begin] = offset - begin;
+        if (offset + size < end)
+            externalFree[offset + size] = end - offset - size;
+        return hostExternalMemory + offset;
+    }
+    return NULL;
+}
+
+static void externalRelease(std::size_t offset, std::size_t size)
+{
+    std::map<std::size_t, std::size_t>::iterator next = externalFree.lower_bound(offset);
+    if (next != externalFree.end() && offset + size == next->first) {
+        size += next->second;
+        externalFree.erase(next++);
+    }
+    if (next != externalFree.begin()) {
+        std::map<std::size_t, std::size_t>::iterator previous = next;
+        --previous;
+        if (previous->first + previous->second == offset) {
+            previous->second += size;
+            return;
+        }
+    }
+    externalFree[offset] = size;
+}
+
+void *hostHeapAllocate(size_t align, size_t size)
+{
+    void *ptr = NULL;
+    if (currentMemory == HostMemory_External) {
+        ptr = externalAllocate(align, size);
+        if (!ptr)
+            return NULL;
+    } else if (posix_memalign(&ptr, align < sizeof(void *) ? sizeof(void *) : align, size) != 0) {
+        return NULL;
+    }
+    blocks[ptr] = size;
+    bytesInUse += size;
+    return ptr;
+}
+
+void efree(void *ptr)
+{
+    std::map<void *, std::size_t>::iterator it = blocks.find(ptr);
+    if (it == blocks.end())
+        std::abort();
+    const std::size_t size = it->second;
+    bytesInUse -= size;
+    blocks.erase(it);
+
+    unsigned char *p = static_cast<unsigned char *>(ptr);
+    if (p >= hostExternalMemory && p < hostExternalMemory + HOST_EXTERNAL_MEMORY_SIZE)
+        externalRelease(p - hostExternalMemory, size);
+    else
+        free(ptr);
+}
@@ -0,0 +1,48 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef HOSTSDK_H
+#define HOSTSDK_H
+
+#include <stddef.h>
+
+// Where the host heap serves blocks from, internal memory is the C heap
+enum HostMemory {
+    HostMemory_Internal,
+    HostMemory_External
+};
+
+void hostHeapSetMemory(HostMemory memory);
+// Bytes handed out by the host heap and not given back with efree()
+size_t hostHeapBytesInUse();
+
+// Software DMA model: one memory channel that completes descriptors in
+// submission order, one per host tick, only while the task is blocked
+// The next completed descriptor reports DMA_ERR and copies nothing
+void hostDmaFailNext();
+// The channel makes no progress for the given number of ticks
+void hostDmaStall(unsigned ticks);
+// Submitted descriptors the channel has not completed yet
+size_t hostDmaPendingDescriptors();
+// Prepared descriptors not given back with hal_dma_free_desc()
+size_t hostDmaDescriptorsInUse();
+unsigned hostTicks();
+
+#endif // HOSTSDK_H
@@ -0,0 +1,34 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef HOST_LK_WRAPPER_H
+#define HOST_LK_WRAPPER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uintptr_t addr_t;
+
+// Host memory is coherent, there is nothing to clean or invalidate
+static inline void arch_clean_cache_range(addr_t, size_t) {}
+static inline void arch_invalidate_cache_range(addr_t, size_t) {}
+static inline void arch_clean_invalidate_cache_range(addr_t, size_t) {}
+
+#endif // HOST_LK_WRAPPER_H
@@ -0,0 +1,77 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#ifndef HOST_PLATFORMINTERFACE_RECT_H
+#define HOST_PLATFORMINTERFACE_RECT_H
+
+// The parts of the Qul geometry types the platform modules use
+
+namespace Qul {
+namespace PlatformInterface {
+
+class Point
+{
+public:
+    Point(int x = 0, int y = 0) : m_x(x), m_y(y) {}
+    int x() const { return m_x; }
+    int y() const { return m_y; }
+
+private:
+    int m_x;
+    int m_y;
+};
+
+class Size
+{
+public:
+    Size(int width = 0, int height = 0) : m_width(width), m_height(height) {}
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+private:
+    int m_width;
+    int m_height;
+};
+
+class Rect
+{
+public:
+    Rect(int x = 0, int y = 0, int width = 0, int height = 0) : m_x(x), m_y(y), m_width(width), m_height(height) {}
+    int x() const { return m_x; }
+    int y() const { return m_y; }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int left() const { return m_x; }
+    int top() const { return m_y; }
+    int right() const { return m_x + m_width - 1; }
+    int bottom() const { return m_y + m_height - 1; }
+    bool isEmpty() const { return m_width <= 0 || m_height <= 0; }
+
+private:
+    int m_x;
+    int m_y;
+    int m_width;
+    int m_height;
+};
+
+} // namespace PlatformInterface
+} // namespace Qul
+
+#endif // HOST_PLATFORMINTERFACE_RECT_H
@@ -0,0 +1,89 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvtest.h"
+#include "hostsdk.h"
+
+#include <sdrvallocator.h>
+#include <sdrvbufferpool.h>
+#include <sdrvscreenbuffer.h>
+
+using namespace Qul;
+using namespace Qul::Platform;
+
+#define PAGE_OBJECTS 48
+#define PAGE_TRANSITIONS 50
+
+// What a page transition of the layer engine allocates: item layer buffer
+// pools, the root compose buffers and small engine objects, some of which
+// grow while the page is shown
+static void pageTransition(bool leakOne)
+{
+    SDRVBufferPool background;
+    SDRVBufferPool list;
+    SDRVBufferPool overlay;
+    CHECK(background.allocate(2, PlatformInterface::Size(320, 120), 320 * 4));
+    CHECK(list.allocate(3, PlatformInterface::Size(200, 96), 200 * 4));
+    CHECK(overlay.allocate(1, PlatformInterface::Size(64, 64), 64 * 2));
+
+    void *objects[PAGE_OBJECTS];
+    for (int i = 0; i < PAGE_OBJECTS; ++i)
+        objects[i] = Allocator::allocate(16 + (i * 37) % 700);
+    for (int i = 0; i < PAGE_OBJECTS; i += 3)
+        objects[i] = Allocator::reallocate(objects[i], 48 + (i * 53) % 900);
+
+    CHECK(acquireScreenBuffer(ScreenBufferUser_RootCompose, 0, 0, 160 * 120 * 4));
+    CHECK(acquireScreenBuffer(ScreenBufferUser_RootCompose, 0, 1, 160 * 120 * 4));
+    releaseScreenBuffers(ScreenBufferUser_RootCompose, 0);
+
+    for (int i = leakOne ? 1 : 0; i < PAGE_OBJECTS; ++i)
+        Allocator::release(objects[i]);
+}
+
+static void testZeroNetGrowth()
+{
+    // The first transition carves the slab pages all later ones reuse
+    pageTransition(false);
+
+    const uint32_t mark = Allocator::trackingMark();
+    const std::size_t heapBefore = hostHeapBytesInUse();
+    for (int i = 0; i < PAGE_TRANSITIONS; ++i)
+        pageTransition(false);
+
+    std::size_t bytes = 0;
+    CHECK(Allocator::liveAllocationsSince(mark, &bytes) == 0);
+    CHECK(bytes == 0);
+    CHECK(hostHeapBytesInUse() == heapBefore);
+}
+
+static void testLeakIsReported()
+{
+    const uint32_t mark = Allocator::trackingMark();
+    pageTransition(true);
+    CHECK(Allocator::liveAllocationsSince(mark) == 1);
+    Allocator::printAllocationsSince(mark);
+}
+
+int main()
+{
+    RUN_TEST(testZeroNetGrowth);
+    RUN_TEST(testLeakIsReported);
+    return testFailures;
+}
@@ -0,0 +1,209 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvtest.h"
+#include "hostsdk.h"
+
+#include <sdrvallocator.h>
+
+#include <cstring>
+
+using namespace Qul::Platform;
+
+static const std::size_t classSizes[] = {16, 32, 48, 64, 96, 128, 192, 256, 384, 512};
+
+static void fill(void *ptr, std::size_t size, unsigned char seed)
+{
+    unsigned char *p = static_cast<unsigned char *>(ptr);
+    for (std::size_t i = 0; i < size; ++i)
+        p[i] = (unsigned char)(seed + i);
+}
+
+static bool filled(const void *ptr, std::size_t size, unsigned char seed)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(ptr);
+    for (std::size_t i = 0; i < size; ++i) {
+        if (p[i] != (unsigned char)(seed + i))
+            return false;
+    }
+    return true;
+}
+
+// Runs first, before any default slab chunk exists
+static void testHotPool()
+{
+    const std::size_t heapBefore = hostHeapBytesInUse();
+    void *hot = Allocator::allocate(32, Allocator::Memory_CpuHot);
+    CHECK(hot);
+    CHECK(hostHeapBytesInUse() == heapBefore);
+
+    // Moving to a larger slab class keeps it in the pool
+    hot = Allocator::reallocate(hot, 200);
+    CHECK(hot);
+    CHECK(Allocator::usableSize(hot) >= 200);
+    CHECK(hostHeapBytesInUse() == heapBefore);
+
+    // Default blocks never take hot pool chunks
+    void *cpu = Allocator::allocate(32);
+    CHECK(cpu);
+    CHECK(hostHeapBytesInUse() > heapBefore);
+
+    Allocator::release(hot);
+    Allocator::release(cpu);
+}
+
+static void testSlabClasses()
+{
+    for (std::size_t size = 1; size <= SDRV_SLAB_MAX_SIZE; ++size) {
+        std::size_t expected = 0;
+        for (std::size_t i = 0; !expected; ++i) {
+            if (classSizes[i] >= size)
+                expected = classSizes[i];
+        }
+        void *ptr = Allocator::allocate(size);
+        CHECK(ptr);
+        CHECK(Allocator::usableSize(ptr) == expected);
+        CHECK(reinterpret_cast<uintptr_t>(ptr) % 16 == 0);
+        Allocator::release(ptr);
+    }
+
+    // Blocks of one class do not overlap, a released block is handed out next
+    unsigned char *first = static_cast<unsigned char *>(Allocator::allocate(40));
+    unsigned char *second = static_cast<unsigned char *>(Allocator::allocate(40));
+    CHECK(first != second);
+    CHECK(first + 48 <= second || second + 48 <= first);
+    Allocator::release(first);
+    CHECK(Allocator::allocate(48) == first);
+    Allocator::release(first);
+    Allocator::release(second);
+}
+
+static void testLargeBlocks()
+{
+    void *ptr = Allocator::allocate(SDRV_SLAB_MAX_SIZE + 1);
+    CHECK(ptr);
+    CHECK(Allocator::usableSize(ptr) >= SDRV_SLAB_MAX_SIZE + 1);
+    CHECK(reinterpret_cast<uintptr_t>(ptr) % 64 == 0);
+    Allocator::release(ptr);
+
+    ptr = Allocator::allocate(SDRV_PAGE_ALIGN_MIN_SIZE);
+    CHECK(ptr);
+    CHECK(reinterpret_cast<uintptr_t>(ptr) % 0x1000 == 0);
+    Allocator::release(ptr);
+}
+
+static void testInPlaceGrow()
+{
+    void *ptr = Allocator::reallocate(NULL, 600);
+    CHECK(ptr);
+    fill(ptr, 600, 1);
+
+    // Past the capacity the block moves and gets slack
+    void *grown = Allocator::reallocate(ptr, 1000);
+    CHECK(grown && grown != ptr);
+    CHECK(filled(grown, 600, 1));
+    CHECK(Allocator::usableSize(grown) >= 1250);
+
+    // Within the slack it stays in place, as does shrinking a large block
+    fill(grown, 1000, 2);
+    CHECK(Allocator::reallocate(grown, 1200) == grown);
+    CHECK(Allocator::reallocate(grown, 800) == grown);
+    CHECK(filled(grown, 800, 2));
+
+    // Slab blocks grow in place within their class
+    void *small = Allocator::allocate(20);
+    CHECK(Allocator::reallocate(small, 32) == small);
+
+    Allocator::release(grown);
+    Allocator::release(small);
+}
+
+static void testShrinkToSlab()
+{
+    void *ptr = Allocator::allocate(2000);
+    CHECK(ptr);
+    fill(ptr, 2000, 3);
+
+    void *shrunk = Allocator::reallocate(ptr, 100);
+    CHECK(shrunk && shrunk != ptr);
+    CHECK(Allocator::usableSize(shrunk) == 128);
+    CHECK(filled(shrunk, 100, 3));
+
+    CHECK(Allocator::reallocate(shrunk, 50) == shrunk);
+    Allocator::release(shrunk);
+}
+
+static void testHardwareMemory()
+{
+    // DC and G2D cannot reach blocks outside external memory
+    hostHeapSetMemory(HostMemory_Internal);
+    const std::size_t heapBefore = hostHeapBytesInUse();
+    CHECK(Allocator::allocate(0x1000, Allocator::Memory_Scanout) == NULL);
+    CHECK(Allocator::allocate(64, Allocator::Memory_G2DScratch) == NULL);
+    CHECK(hostHeapBytesInUse() == heapBefore);
+
+    hostHeapSetMemory(HostMemory_External);
+    void *ptr = Allocator::allocate(64, Allocator::Memory_G2DScratch);
+    CHECK(ptr);
+    CHECK(reinterpret_cast<uintptr_t>(ptr) % 0x1000 == 0);
+    Allocator::release(ptr);
+}
+
+static void testTrackingRemoval()
+{
+    static const std::size_t sizes[] = {16, 100, 512, 513, 3000, 70000};
+    const int count = sizeof(sizes) / sizeof(sizes[0]);
+    void *blocks[count];
+
+    const uint32_t mark = Allocator::trackingMark();
+    for (int i = 0; i < count; ++i)
+        blocks[i] = Allocator::allocate(sizes[i]);
+    CHECK(Allocator::liveAllocationsSince(mark) == uint32_t(count));
+
+    // Moved and resized blocks are tracked under their new address and size
+    std::size_t bytes = 0;
+    for (int i = 0; i < count; ++i) {
+        blocks[i] = Allocator::reallocate(blocks[i], sizes[count - 1 - i]);
+        bytes += sizes[count - 1 - i];
+    }
+    std::size_t trackedBytes = 0;
+    CHECK(Allocator::liveAllocationsSince(mark, &trackedBytes) == uint32_t(count));
+    CHECK(trackedBytes == bytes);
+
+    for (int i = 0; i < count; i += 2)
+        Allocator::release(blocks[i]);
+    CHECK(Allocator::liveAllocationsSince(mark) == uint32_t(count / 2));
+    for (int i = 1; i < count; i += 2)
+        Allocator::release(blocks[i]);
+    CHECK(Allocator::liveAllocationsSince(mark) == 0);
+}
+
+int main()
+{
+    RUN_TEST(testHotPool);
+    RUN_TEST(testSlabClasses);
+    RUN_TEST(testLargeBlocks);
+    RUN_TEST(testInPlaceGrow);
+    RUN_TEST(testShrinkToSlab);
+    RUN_TEST(testHardwareMemory);
+    RUN_TEST(testTrackingRemoval);
+    Allocator::printStats();
+    return testFailures;
+}
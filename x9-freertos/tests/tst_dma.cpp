@@ -0,0 +1,187 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvtest.h"
+#include "hostsdk.h"
+
+#include <sdrvdma.h>
+#include <sdrvwakeup.h>
+
+#include <cstring>
+
+using namespace Qul::Platform;
+
+#define COPY_SIZE (SDRV_DMA_CHUNK_SIZE * 3 + 100)
+
+static unsigned char source[2][COPY_SIZE];
+static unsigned char destination[2][COPY_SIZE];
+
+static void fill(int index, unsigned char seed)
+{
+    for (int i = 0; i < COPY_SIZE; ++i)
+        source[index][i] = (unsigned char)(seed + i * 7);
+    std::memset(destination[index], 0, COPY_SIZE);
+}
+
+static bool copied(int index)
+{
+    return std::memcmp(source[index], destination[index], COPY_SIZE) == 0;
+}
+
+static bool untouched(int index)
+{
+    for (int i = 0; i < COPY_SIZE; ++i) {
+        if (destination[index][i] != 0)
+            return false;
+    }
+    return true;
+}
+
+static void testSyncCopy()
+{
+    fill(0, 1);
+    CHECK(dmaCopy(destination[0], source[0], COPY_SIZE));
+    CHECK(copied(0));
+    CHECK(hostDmaDescriptorsInUse() == 0);
+}
+
+static void testAsyncCopyRunsWhileWaiting()
+{
+    fill(0, 2);
+    const int id = dmaCopyAsync(destination[0], source[0], COPY_SIZE);
+    CHECK(id >= 0);
+    // Nothing moves until the engine task blocks
+    CHECK(!dmaTransferDone(id));
+    CHECK(hostDmaPendingDescriptors() == 4);
+    CHECK(untouched(0));
+
+    dmaWait(id);
+    CHECK(dmaTransferDone(id));
+    CHECK(copied(0));
+    CHECK(hostDmaDescriptorsInUse() == 0);
+}
+
+// The channel completes in submission order, waiting for the second transfer
+// finishes the first one as well
+static void testCompletionOrder()
+{
+    fill(0, 3);
+    fill(1, 4);
+    const int first = dmaCopyAsync(destination[0], source[0], COPY_SIZE);
+    const int second = dmaCopyAsync(destination[1], source[1], COPY_SIZE);
+    CHECK(first >= 0 && second >= 0 && first != second);
+
+    dmaWait(second);
+    CHECK(dmaTransferDone(first));
+    CHECK(copied(0));
+    CHECK(copied(1));
+    CHECK(hostDmaDescriptorsInUse() == 0);
+}
+
+static void testWaitForRangeOnlyWaitsForOverlaps()
+{
+    fill(0, 5);
+    fill(1, 6);
+    const int first = dmaCopyAsync(destination[0], source[0], COPY_SIZE);
+    const int second = dmaCopyAsync(destination[1], source[1], COPY_SIZE);
+
+    // Memory touching neither transfer, including the byte right after one
+    static unsigned char unrelated[64];
+    dmaWaitForRange(unrelated, unrelated + sizeof(unrelated));
+    dmaWaitForRange(destination[0] + COPY_SIZE, destination[0] + COPY_SIZE);
+    CHECK(hostDmaPendingDescriptors() == 8);
+
+    // A range inside the first destination leaves the second transfer queued
+    dmaWaitForRange(destination[0] + 10, destination[0] + 20);
+    CHECK(dmaTransferDone(first));
+    CHECK(copied(0));
+    CHECK(!dmaTransferDone(second));
+    CHECK(hostDmaPendingDescriptors() == 4);
+    CHECK(untouched(1));
+
+    // The source range of a transfer counts as busy too
+    dmaWaitForRange(source[1] + COPY_SIZE - 1, source[1] + COPY_SIZE);
+    CHECK(dmaTransferDone(second));
+    CHECK(copied(1));
+    CHECK(hostDmaDescriptorsInUse() == 0);
+}
+
+static void testFailedChunkFallsBackToCpu()
+{
+    fill(0, 7);
+    hostDmaFailNext();
+    const int id = dmaCopyAsync(destination[0], source[0], COPY_SIZE);
+    dmaWait(id);
+    CHECK(copied(0));
+    CHECK(hostDmaDescriptorsInUse() == 0);
+
+    fill(0, 8);
+    hostDmaFailNext();
+    CHECK(!dmaCopy(destination[0], source[0], COPY_SIZE));
+    CHECK(hostDmaDescriptorsInUse() == 0);
+}
+
+static void testTransferLimits()
+{
+    CHECK(dmaCopyAsync(destination[0], source[0], 0) == -1);
+    CHECK(dmaCopyAsync(destination[0], source[0], SDRV_DMA_MAX_ASYNC_SIZE + 1) == -1);
+
+    int ids[SDRV_DMA_MAX_TRANSFERS];
+    for (int i = 0; i < SDRV_DMA_MAX_TRANSFERS; ++i) {
+        ids[i] = dmaCopyAsync(destination[0] + i * 16, source[0] + i * 16, 16);
+        CHECK(ids[i] >= 0);
+    }
+    CHECK(dmaCopyAsync(destination[1], source[1], 16) == -1);
+
+    dmaWait(ids[0]);
+    const int id = dmaCopyAsync(destination[1], source[1], 16);
+    CHECK(id >= 0);
+    dmaWaitForRange(destination[0], destination[1] + COPY_SIZE);
+    for (int i = 0; i < SDRV_DMA_MAX_TRANSFERS; ++i)
+        CHECK(dmaTransferDone(ids[i]));
+    CHECK(dmaTransferDone(id));
+    CHECK(hostDmaDescriptorsInUse() == 0);
+}
+
+// A late transfer is waited for past the timeout instead of being abandoned
+static void testStalledTransfer()
+{
+    fill(0, 9);
+    const int id = dmaCopyAsync(destination[0], source[0], COPY_SIZE);
+    hostDmaStall(250);
+    const unsigned start = hostTicks();
+    dmaWait(id);
+    CHECK(hostTicks() - start >= 250);
+    CHECK(copied(0));
+}
+
+int main()
+{
+    initEngineWakeup();
+
+    RUN_TEST(testSyncCopy);
+    RUN_TEST(testAsyncCopyRunsWhileWaiting);
+    RUN_TEST(testCompletionOrder);
+    RUN_TEST(testWaitForRangeOnlyWaitsForOverlaps);
+    RUN_TEST(testFailedChunkFallsBackToCpu);
+    RUN_TEST(testTransferLimits);
+    RUN_TEST(testStalledTransfer);
+    return testFailures;
+}
@@ -0,0 +1,190 @@
+/******************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Quick Ultralite module.
+**
+** $QT_BEGIN_LICENSE:COMM$
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** $QT_END_LICENSE$
+**
+******************************************************************************/
+#include "sdrvtest.h"
+
+#include <sdrvassetpreload.h>
+#include <sdrvrle.h>
+
+#include <cstdint>
+#include <cstring>
+
+using namespace Qul::Platform;
+
+// Test data lives in no asset segment
+namespace Qul {
+namespace Platform {
+std::size_t assetDataSize(const void *, std::size_t maxSize)
+{
+    return maxSize;
+}
+} // namespace Platform
+} // namespace Qul
+
+#define CLEAR 0x00000000u
+#define WHITE 0xffffffffu
+#define BLUE  0xff2050e0u
+#define RED   0xffe02020u
+#define SHADE 0x80000000u
+
+// 8x3 icon in the resource compiler's chunk layout, pixels little endian
+static const unsigned char icon8x3[] = {
+    // Row 0: 3 clear, 2 blue, 3 clear
+    0x82, 0x00, 0x00, 0x00, 0x00,
+    0x81, 0xe0, 0x50, 0x20, 0xff,
+    0x82, 0x00, 0x00, 0x00, 0x00,
+    // Row 1: clear, blue, white, red, white, blue, 2 clear, the run goes on
+    // into row 2, runs cross line ends
+    0x00, 0x00, 0x00, 0x00, 0x00,
+    0x04, 0xe0, 0x50, 0x20, 0xff, 0xff, 0xff, 0xff, 0xff, 0x20, 0x20, 0xe0, 0xff,
+          0xff, 0xff, 0xff, 0xff, 0xe0, 0x50, 0x20, 0xff,
+    0x82, 0x00, 0x00, 0x00, 0x00,
+    // Row 2: shadow under the rest of the icon
+    0x86, 0x00, 0x00, 0x00, 0x80,
+};
+
+static const uint32_t icon8x3Pixels[] = {
+    CLEAR, CLEAR, CLEAR, BLUE, BLUE, CLEAR, CLEAR, CLEAR,
+    CLEAR, BLUE, WHITE, RED, WHITE, BLUE, CLEAR, CLEAR,
+    CLEAR, SHADE, SHADE, SHADE, SHADE, SHADE, SHADE, SHADE,
+};
+
+// Bytes after the decoded size that the decoder must leave alone
+#define GUARD_PIXELS 4
+#define GUARD_PIXEL 0xa5a5a5a5u
+
+static bool decode(const unsigned char *src, std::size_t srcSize, uint32_t *pixels, std::size_t count)
+{
+    for (std::size_t i = 0; i < count + GUARD_PIXELS; ++i)
+        pixels[i] = GUARD_PIXEL;
+    return decodeRle32(src, srcSize, (unsigned char *)pixels, count * 4);
+}
+
+static bool guardIntact(const uint32_t *pixels, std::size_t count)
+{
+    for (std::size_t i = count; i < count + GUARD_PIXELS; ++i) {
+        if (pixels[i] != GUARD_PIXEL)
+            return false;
+    }
+    return true;
+}
+
+static void testIcon()
+{
+    const std::size_t count = sizeof(icon8x3Pixels) / 4;
+    uint32_t pixels[count + GUARD_PIXELS];
+    CHECK(decode(icon8x3, sizeof(icon8x3), pixels, count));
+    CHECK(std::memcmp(pixels, icon8x3Pixels, sizeof(icon8x3Pixels)) == 0);
+    CHECK(guardIntact(pixels, count));
+}
+
+static void testLongRuns()
+{
+    // 200 pixels of one color take a full 128 pixel run and a 72 pixel one,
+    // followed by a full 128 pixel literal run
+    const std::size_t count = 200 + 128;
+    unsigned char stream[5 + 5 + 1 + 128 * 4];
+    unsigned char *p = stream;
+    *p++ = 0xff;
+    std::memcpy(p, "\x20\x20\xe0\xff", 4);
+    p += 4;
+    *p++ = 0x80 | (72 - 1);
+    std::memcpy(p, "\x20\x20\xe0\xff", 4);
+    p += 4;
+    *p++ = 0x7f;
+    for (uint32_t i = 0; i < 128; ++i) {
+        const uint32_t pixel = 0xff000000u | i;
+        std::memcpy(p, &pixel, 4);
+        p += 4;
+    }
+
+    uint32_t pixels[count + GUARD_PIXELS];
+    CHECK(decode(stream, sizeof(stream), pixels, count));
+    int wrongPixels = 0;
+    for (std::size_t i = 0; i < count; ++i)
+        wrongPixels += pixels[i] != (i < 200 ? RED : 0xff000000u | uint32_t(i - 200));
+    CHECK(wrongPixels == 0);
+    CHECK(guardIntact(pixels, count));
+}
+
+static void testRunsClampedToSize()
+{
+    // A texture ending inside a run only gets its own pixels
+    const unsigned char repeat[] = {0x8f, 0xff, 0xff, 0xff, 0xff};
+    uint32_t pixels[3 + GUARD_PIXELS];
+    CHECK(decode(repeat, sizeof(repeat), pixels, 3));
+    CHECK(pixels[0] == WHITE && pixels[1] == WHITE && pixels[2] == WHITE);
+    CHECK(guardIntact(pixels, 3));
+
+    CHECK(decode(icon8x3, sizeof(icon8x3), pixels, 3));
+    CHECK(std::memcmp(pixels, icon8x3Pixels, 3 * 4) == 0);
+    CHECK(guardIntact(pixels, 3));
+}
+
+static void testRejectsTruncatedData()
+{
+    // Every cut decodes from a copy of exactly the remaining bytes, so that a
+    // read past the end shows up in memory checkers
+    const std::size_t count = sizeof(icon8x3Pixels) / 4;
+    uint32_t pixels[count + GUARD_PIXELS];
+    int accepted = 0;
+    int overruns = 0;
+    for (std::size_t size = 0; size < sizeof(icon8x3); ++size) {
+        unsigned char *cut = new unsigned char[size];
+        std::memcpy(cut, icon8x3, size);
+        accepted += decode(cut, size, pixels, count);
+        overruns += !guardIntact(pixels, count);
+        delete[] cut;
+    }
+    CHECK(accepted == 0);
+    CHECK(overruns == 0);
+}
+
+static void testDataSize()
+{
+    // One header byte per pixel in the worst case
+    CHECK(rleDataSize(icon8x3, 24 * 4) == 24 * 5);
+    CHECK(rleDataSize(icon8x3, 24 * 4) >= sizeof(icon8x3));
+}
+
+static void testFormats()
+{
+    CHECK(rleDecoder(Qul::PixelFormat_RLE_ARGB32) == decodeRle32);
+    CHECK(rleDecoder(Qul::PixelFormat_RLE_ARGB32_Premultiplied) == decodeRle32);
+    CHECK(rleDecoder(Qul::PixelFormat_RLE_RGB32) == decodeRle32);
+    CHECK(rleDecoder(Qul::PixelFormat_RLE_RGB888) == NULL);
+    CHECK(rleDecoder(Qul::PixelFormat_ARGB32) == NULL);
+
+    CHECK(rleDecodedFormat(Qul::PixelFormat_RLE_ARGB32) == Qul::PixelFormat_ARGB32);
+    CHECK(rleDecodedFormat(Qul::PixelFormat_RLE_ARGB32_Premultiplied) == Qul::PixelFormat_ARGB32_Premultiplied);
+    CHECK(rleDecodedFormat(Qul::PixelFormat_RLE_RGB32) == Qul::PixelFormat_RGB32);
+    CHECK(rleDecodedFormat(Qul::PixelFormat_RGB16) == Qul::PixelFormat_RGB16);
+}
+
+int main()
+{
+    RUN_TEST(testIcon);
+    RUN_TEST(testLongRuns);
+    RUN_TEST(testRunsClampedToSize);
+    RUN_TEST(testRejectsTruncatedData);
+    RUN_TEST(testDataSize);
+    RUN_TEST(testFormats);
+    return testFailures;
+}